@@ -0,0 +1,78 @@
+#include "MappedFile.h"
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+MappedFile::MappedFile(const std::string &path) {
+#ifdef MAPPED_FILE_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("Cannot open '{}': {}", path,
+                                         std::strerror(errno)));
+  }
+
+  struct stat status {};
+
+  if (fstat(fd, &status) != 0) {
+    const int error = errno;
+    ::close(fd);
+
+    throw std::runtime_error(
+        fmt::format("Cannot stat '{}': {}", path, std::strerror(error)));
+  }
+
+  this->_size = (size_t)status.st_size;
+
+  if (this->_size != 0) {
+    void *mapping =
+        mmap(nullptr, this->_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (mapping == MAP_FAILED) {
+      const int error = errno;
+      ::close(fd);
+
+      throw std::runtime_error(
+          fmt::format("Cannot map '{}': {}", path, std::strerror(error)));
+    }
+
+    this->_data = (const uint8_t *)mapping;
+  }
+
+  // Mapping stays valid after descriptor is closed.
+  ::close(fd);
+#else
+  std::ifstream stream(path, std::ios_base::binary);
+
+  if (!stream) {
+    throw std::runtime_error(fmt::format("Cannot open '{}'", path));
+  }
+
+  this->_fallback.assign(std::istreambuf_iterator<char>(stream),
+                         std::istreambuf_iterator<char>());
+  this->_data = this->_fallback.data();
+  this->_size = this->_fallback.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef MAPPED_FILE_MMAP
+  if (this->_data != nullptr) {
+    munmap((void *)this->_data, this->_size);
+  }
+#endif
+}
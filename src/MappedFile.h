@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Read only memory mapping of whole file. On platforms without mmap file is
+ * read into memory instead.
+ */
+class MappedFile {
+ private:
+  const uint8_t *_data = nullptr;
+  size_t _size = 0;
+  std::vector<uint8_t> _fallback;
+
+ public:
+  /**
+   * @param path
+   * @throws runtime_error If file cannot be opened or mapped.
+   */
+  explicit MappedFile(const std::string &path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  [[nodiscard]] const uint8_t *data() const { return this->_data; }
+
+  [[nodiscard]] size_t size() const { return this->_size; }
+};
@@ -0,0 +1,47 @@
+#include "PrefixedBuffer.h"
+
+#include <algorithm>
+#include <utility>
+
+PrefixedBuffer::PrefixedBuffer(std::vector<char> prefix, std::streambuf *source)
+    : _prefix(std::move(prefix)), _chunk(16 * 1024), _source(source) {
+  this->setg(this->_prefix.data(), this->_prefix.data(),
+             this->_prefix.data() + this->_prefix.size());
+}
+
+PrefixedBuffer::int_type PrefixedBuffer::underflow() {
+  if (this->gptr() < this->egptr()) {
+    return traits_type::to_int_type(*this->gptr());
+  }
+
+  const std::streamsize count = this->_source->sgetn(
+      this->_chunk.data(), (std::streamsize)this->_chunk.size());
+
+  if (count <= 0) {
+    return traits_type::eof();
+  }
+
+  this->setg(this->_chunk.data(), this->_chunk.data(),
+             this->_chunk.data() + count);
+
+  return traits_type::to_int_type(*this->gptr());
+}
+
+std::streamsize PrefixedBuffer::xsgetn(char_type *data,
+                                       std::streamsize count) {
+  const std::streamsize buffered = std::min(
+      count, (std::streamsize)(this->egptr() - this->gptr()));
+
+  traits_type::copy(data, this->gptr(), (size_t)buffered);
+  this->gbump((int)buffered);
+
+  if (buffered == count) {
+    return count;
+  }
+
+  // Rest goes straight from source, without copying through chunk.
+  const std::streamsize read =
+      this->_source->sgetn(data + buffered, count - buffered);
+
+  return buffered + std::max<std::streamsize>(read, 0);
+}
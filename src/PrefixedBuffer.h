@@ -0,0 +1,27 @@
+#pragma once
+
+#include <streambuf>
+#include <vector>
+
+/**
+ * Reads already consumed prefix, then rest of source. Lets a stream which
+ * cannot seek back be read again from start after sniffing its header.
+ */
+class PrefixedBuffer : public std::basic_streambuf<char> {
+ private:
+  std::vector<char> _prefix;
+  std::vector<char> _chunk;
+  std::streambuf *_source;
+
+ protected:
+  int_type underflow() override;
+
+  std::streamsize xsgetn(char_type *data, std::streamsize count) override;
+
+ public:
+  /**
+   * @param prefix Bytes already read from source.
+   * @param source
+   */
+  PrefixedBuffer(std::vector<char> prefix, std::streambuf *source);
+};
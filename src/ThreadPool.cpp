@@ -0,0 +1,73 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  this->_threads.reserve(threads);
+
+  for (size_t i = 0; i < threads; i++) {
+    this->_threads.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    this->_stopping = true;
+  }
+
+  this->_condition.notify_all();
+
+  for (auto &thread : this->_threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(this->_mutex);
+
+      this->_condition.wait(lock, [this]() {
+        return this->_stopping || !this->_tasks.empty();
+      });
+
+      if (this->_tasks.empty()) {
+        return;
+      }
+
+      task = std::move(this->_tasks.front());
+      this->_tasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+bool ThreadPool::runPendingTask() {
+  std::function<void()> task;
+
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    if (this->_tasks.empty()) {
+      return false;
+    }
+
+    task = std::move(this->_tasks.front());
+    this->_tasks.pop_front();
+  }
+
+  task();
+
+  return true;
+}
+
+size_t ThreadPool::getThreadCount() const { return this->_threads.size(); }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed number of worker threads executing submitted tasks in order.
+ */
+class ThreadPool {
+ private:
+  std::vector<std::thread> _threads;
+  std::deque<std::function<void()>> _tasks;
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  bool _stopping = false;
+
+  void work();
+
+ public:
+  /**
+   * @param threads If 0, number of hardware threads.
+   */
+  explicit ThreadPool(size_t threads = 0);
+
+  /**
+   * Finishes queued tasks and joins workers.
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  template <class F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit(F &&task) {
+    using Result = std::invoke_result_t<std::decay_t<F>>;
+
+    auto packaged =
+        std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> result = packaged->get_future();
+
+    {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+
+      this->_tasks.emplace_back([packaged]() { (*packaged)(); });
+    }
+
+    this->_condition.notify_one();
+
+    return result;
+  }
+
+  /**
+   * Waits for future, executing queued tasks meanwhile. Use it instead of
+   * future.get() inside tasks, so pool does not deadlock waiting on itself.
+   * @param future
+   * @return Result of future.
+   */
+  template <class T>
+  T await(std::future<T> &future) {
+    this->wait(future);
+
+    return future.get();
+  }
+
+  /**
+   * Same as await, but leaves result or exception in future.
+   * @param future
+   */
+  template <class T>
+  void wait(const std::future<T> &future) {
+    while (future.wait_for(std::chrono::seconds(0)) !=
+           std::future_status::ready) {
+      if (!this->runPendingTask()) {
+        future.wait_for(std::chrono::milliseconds(1));
+      }
+    }
+  }
+
+  /**
+   * Executes one queued task on calling thread.
+   * @return false if queue was empty.
+   */
+  bool runPendingTask();
+
+  [[nodiscard]] size_t getThreadCount() const;
+};
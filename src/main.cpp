@@ -1,24 +1,55 @@
+#ifndef MODPLAYER_HEADLESS
 #include <SDL.h>
+#endif
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <sstream>
 #include <vector>
 
-#include "../ignore-mods/arilou.mod.h"
-#include "MemoryStream.h"
 #include "fmt/format.h"
 #include "mod/Generator.h"
 #include "mod/InfoString.h"
+#include "mod/Realtime.h"
 #include "mod/Row.h"
-#include "mod/loaders/ModLoader.h"
-#include "mod/loaders/TrackerLoader.h"
+#include "mod/loaders/LoaderRegistry.h"
+#include "mod/writer/BatchRenderer.h"
+#include "mod/writer/FlacWriter.h"
+#include "mod/writer/MappedWriter.h"
 #include "mod/writer/RawWriter.h"
 #include "mod/writer/WavWriter.h"
 
+struct Options {
+  std::string input = "ignore-mods/slyhome.mod";
+  // Song is rendered to file instead of played if set.
+  std::string output;
+  // Taken from extension of output if not set.
+  std::optional<mod::OutputFormat> format;
+  // Defaults are device format when playing, 44100 Hz signed 16 bit else.
+  std::optional<float> frequency;
+  std::optional<mod::Encoding> encoding;
+  mod::Interpolation interpolation = mod::Interpolation::Nearest;
+  size_t loops = 1;
+  bool bench = false;
+  std::optional<mod::realtime::RealtimeOptions> realtime;
+};
+
+constexpr float defaultRenderFrequency = 44100.0f;
+
+#ifndef MODPLAYER_HEADLESS
+
 extern void fill_audio(void *udata, Uint8 *stream, int len);
 
+struct Playback {
+  mod::Generator *generator = nullptr;
+  std::optional<mod::realtime::RealtimeOptions> realtime;
+  bool threadPrepared = false;
+};
+
 SDL_AudioSpec initAudio(SDL_AudioSpec wanted) {
   /* Set the audio format */
   //  wanted.freq = (int)(11025 * 2.0f);
@@ -127,29 +158,55 @@ mod::Encoding sdlToEncoding(int sdl) {
   }
 }
 
-void playMod(std::istream &stream) {
+int encodingToSdl(mod::Encoding encoding) {
+  switch (encoding) {
+    case mod::Encoding::Signed8:
+      return AUDIO_S8;
+    case mod::Encoding::Unsigned16:
+      return AUDIO_U16;
+    case mod::Encoding::Signed16:
+      return AUDIO_S16;
+    default:
+      return AUDIO_U8;
+  }
+}
+
+void playMod(const Options &options) {
   using namespace mod;
 
-  std::shared_ptr<TrackerLoader> trackerLoader = std::make_shared<ModLoader>();
-  std::shared_ptr<Mod> serializedMod = trackerLoader->load(stream);
+  const std::optional<realtime::RealtimeOptions> &realtime = options.realtime;
+
+  const LoaderRegistry registry = LoaderRegistry::createDefault();
+  std::shared_ptr<Mod> serializedMod = registry.load(options.input);
 
   std::cout << mod::InfoString::toString(*serializedMod) << "\n";
 
+  if (realtime && !realtime::lockMod(*serializedMod)) {
+    std::cout << "Could not lock mod data in memory, continuing unlocked"
+              << std::endl;
+  }
+
   mod::Generator generator(serializedMod, mod::Encoding::Unsigned8);
 
+  generator.setInterpolation(options.interpolation);
+  generator.setLoopCount(options.loops);
   setCallbacks(generator);
 
   generator.restart();
   SDL_AudioSpec wanted;
-  wanted.freq = (int)(11025 * 2.0f);
+  wanted.freq = (int)options.frequency.value_or(11025 * 2.0f);
   //  wanted.freq = 48000;
   //  wanted.freq = 48000;
   //  wanted.freq = 8353;
-  wanted.format = AUDIO_U8;
+  wanted.format =
+      encodingToSdl(options.encoding.value_or(mod::Encoding::Unsigned8));
   wanted.channels = 1;   /* 1 = mono, 2 = stereo */
   wanted.samples = 1024; /* Good low-latency value for callback */
   wanted.callback = fill_audio;
-  wanted.userdata = &generator;
+  Playback playback;
+  playback.generator = &generator;
+  playback.realtime = realtime;
+  wanted.userdata = &playback;
   SDL_AudioSpec obtained = initAudio(wanted);
   printDifference(wanted, obtained);
   generator.setFrequency((float)obtained.freq);
@@ -166,7 +223,269 @@ void playMod(std::istream &stream) {
 #endif
 }
 
-int main() {
+#endif
+
+/**
+ * Parses player flags: [--input|-i] <file>, --output|-o <file>, --format
+ * raw|wav|flac, --rate Hz, --encoding u8|s8|u16|s16, --interpolation
+ * nearest|linear, --loops N, --bench and realtime flags --realtime,
+ * --rt-policy fifo|rr, --rt-priority N.
+ * @throws invalid_argument
+ */
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  bool inputSet = false;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string argument = argv[i];
+    const bool hasValue = i + 1 < argc;
+
+    if ((argument == "--input" || argument == "-i") && hasValue) {
+      options.input = argv[++i];
+      inputSet = true;
+    } else if ((argument == "--output" || argument == "-o") && hasValue) {
+      options.output = argv[++i];
+    } else if (argument == "--format" && hasValue) {
+      options.format = mod::BatchRenderer::formatFromString(argv[++i]);
+    } else if (argument == "--rate" && hasValue) {
+      options.frequency = std::stof(argv[++i]);
+    } else if (argument == "--encoding" && hasValue) {
+      options.encoding = mod::encodingFromString(argv[++i]);
+    } else if (argument == "--interpolation" && hasValue) {
+      options.interpolation = mod::interpolationFromString(argv[++i]);
+    } else if (argument == "--loops" && hasValue) {
+      options.loops = std::stoul(argv[++i]);
+    } else if (argument == "--bench") {
+      options.bench = true;
+    } else if (argument == "--realtime") {
+      options.realtime.emplace();
+    } else if (argument == "--rt-policy" && hasValue) {
+      options.realtime.emplace(
+          options.realtime.value_or(mod::realtime::RealtimeOptions{}));
+      options.realtime->policy = mod::realtime::policyFromString(argv[++i]);
+    } else if (argument == "--rt-priority" && hasValue) {
+      options.realtime.emplace(
+          options.realtime.value_or(mod::realtime::RealtimeOptions{}));
+      options.realtime->priority = std::stoi(argv[++i]);
+    } else if (argument.rfind("--", 0) != 0 && !inputSet) {
+      options.input = argument;
+      inputSet = true;
+    } else {
+      throw std::invalid_argument(
+          fmt::format("Unknown argument: '{}'", argument));
+    }
+  }
+
+  if (options.loops == 0) {
+    throw std::invalid_argument("--loops must be above 0");
+  }
+
+  return options;
+}
+
+/**
+ * @param options
+ * @param mod
+ * @return Generator with render options, 44100 Hz signed 16 bit by default.
+ */
+mod::Generator createRenderGenerator(const Options &options,
+                                     std::shared_ptr<const mod::Mod> mod) {
+  mod::Generator generator(std::move(mod),
+                           options.encoding.value_or(mod::Encoding::Signed16));
+
+  generator.setFrequency(options.frequency.value_or(defaultRenderFrequency));
+  generator.setInterpolation(options.interpolation);
+  generator.setLoopCount(options.loops);
+
+  return generator;
+}
+
+/**
+ * Renders input to output file, in format of --format or output extension.
+ * @return Exit code.
+ * @throws runtime_error
+ */
+int renderToFile(const Options &options) {
+  using namespace mod;
+
+  OutputFormat format = OutputFormat::Raw;
+
+  if (options.format) {
+    format = *options.format;
+  } else {
+    const size_t dot = options.output.rfind('.');
+
+    if (dot != std::string::npos) {
+      format = BatchRenderer::formatFromString(options.output.substr(dot + 1));
+    }
+  }
+
+  Generator generator = createRenderGenerator(
+      options, LoaderRegistry::createDefault().load(options.input));
+  size_t bytes;
+
+  if (format == OutputFormat::Flac) {
+    std::ofstream stream(options.output,
+                         std::ios_base::binary | std::ios_base::trunc);
+
+    if (!stream) {
+      throw std::runtime_error(
+          fmt::format("Cannot create '{}'", options.output));
+    }
+
+    FlacWriter().write(generator, stream);
+    bytes = (size_t)stream.tellp();
+  } else {
+    bytes = MappedWriter(format).write(generator, options.output);
+  }
+
+  std::cout << fmt::format("Wrote {} bytes to '{}'", bytes, options.output)
+            << std::endl;
+
+  return 0;
+}
+
+/**
+ * Renders input to null sink, timing each phase separately.
+ * @return Exit code.
+ * @throws runtime_error
+ */
+int runBench(const Options &options) {
+  using namespace mod;
+  using Clock = std::chrono::steady_clock;
+
+  constexpr size_t blockFrames = 16 * 1024;
+
+  const auto seconds = [](Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+  };
+
+  const auto loadStart = Clock::now();
+  std::shared_ptr<Mod> loaded = LoaderRegistry::createDefault().load(options.input);
+  const auto loadEnd = Clock::now();
+
+  Generator generator = createRenderGenerator(options, loaded);
+  const size_t frames = generator.countFrames();
+  const auto countEnd = Clock::now();
+
+  const size_t blockSize =
+      blockFrames * bytesInEncoding(generator.getAudioDataEncoding());
+  std::vector<uint8_t> sink(blockSize);
+
+  generator.reserveBuffer(blockSize);
+  generator.restart();
+
+  for (size_t rendered = 0; rendered < frames; rendered += blockFrames) {
+    generator.generate(sink.data(), sink.size());
+  }
+
+  const auto renderEnd = Clock::now();
+
+  const double audioSeconds = (double)frames / generator.getFrequency();
+  const double renderSeconds = seconds(countEnd, renderEnd);
+
+  std::cout << mod::InfoString::toString(*loaded) << "\n";
+  std::cout << fmt::format("Audio: {} frames, {:.2f} s at {} Hz {}", frames,
+                           audioSeconds, generator.getFrequency(),
+                           encodingToString(generator.getAudioDataEncoding()))
+            << std::endl;
+  std::cout << fmt::format("Load: {:.3f} ms", seconds(loadStart, loadEnd) * 1e3)
+            << std::endl;
+  std::cout << fmt::format("Count frames: {:.3f} ms",
+                           seconds(loadEnd, countEnd) * 1e3)
+            << std::endl;
+  std::cout << fmt::format(
+                   "Render: {:.3f} ms, {:.0f} frames/s, {:.1f}x realtime",
+                   renderSeconds * 1e3,
+                   (double)frames / std::max(renderSeconds, 1e-9),
+                   audioSeconds / std::max(renderSeconds, 1e-9))
+            << std::endl;
+
+  return 0;
+}
+
+/**
+ * Renders mods to files: --batch <output-dir> [--format raw|wav|flac]
+ * [--jobs N] [--memory-budget MiB] <input>... Inputs are files, directories
+ * or wildcard patterns. Prints line per file as it is done and failures at
+ * end.
+ * @return Exit code, 1 if any file failed.
+ * @throws invalid_argument
+ */
+int runBatch(int argc, char **argv) {
+  using namespace mod;
+
+  if (argc < 3) {
+    throw std::invalid_argument(
+        "Usage: --batch <output-dir> [--format raw|wav|flac] [--jobs N] "
+        "[--memory-budget MiB] <input>...");
+  }
+
+  const std::string outputDirectory = argv[2];
+  BatchOptions options;
+  std::vector<std::string> patterns;
+
+  for (int i = 3; i < argc; i++) {
+    const std::string argument = argv[i];
+
+    if (argument == "--format" && i + 1 < argc) {
+      options.format = BatchRenderer::formatFromString(argv[++i]);
+    } else if (argument == "--jobs" && i + 1 < argc) {
+      options.workers = std::stoul(argv[++i]);
+    } else if (argument == "--memory-budget" && i + 1 < argc) {
+      options.memoryBudget = std::stoul(argv[++i]) * 1024 * 1024;
+    } else if (argument.rfind("--", 0) == 0) {
+      throw std::invalid_argument(
+          fmt::format("Unknown argument: '{}'", argument));
+    } else {
+      patterns.push_back(argument);
+    }
+  }
+
+  const std::vector<BatchInput> inputs = BatchRenderer::collectInputs(patterns);
+  BatchRenderer renderer(options);
+
+  renderer.setProgressCallback([&options](const BatchResult &result,
+                                          size_t completed, size_t total) {
+    if (!result.succeeded()) {
+      std::cout << fmt::format("[{}/{}] Failed '{}': {}", completed, total,
+                               result.input, result.error)
+                << std::endl;
+      return;
+    }
+
+    const double seconds = (double)result.frames / options.frequency;
+
+    std::cout << fmt::format(
+                     "[{}/{}] '{}' -> '{}': {:.1f} s of audio, load {:.3f} s, "
+                     "render {:.3f} s, {:.1f}x realtime",
+                     completed, total, result.input, result.output, seconds,
+                     result.loadSeconds, result.renderSeconds,
+                     seconds / std::max(result.renderSeconds, 1e-9))
+              << std::endl;
+  });
+
+  const std::vector<BatchResult> results =
+      renderer.render(inputs, outputDirectory);
+  const size_t failed =
+      std::count_if(results.begin(), results.end(),
+                    [](const BatchResult &result) { return !result.succeeded(); });
+
+  std::cout << fmt::format("Rendered {} files, failed {}",
+                           results.size() - failed, failed)
+            << std::endl;
+
+  for (const BatchResult &result : results) {
+    if (!result.succeeded()) {
+      std::cout << fmt::format("  '{}': {}", result.input, result.error)
+                << std::endl;
+    }
+  }
+
+  return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
   using namespace mod;
   // TODO: comandr.mod + 11025.0f * 0.4f not working
   // TODO: Speed change not affected by frequency
@@ -174,17 +493,70 @@ int main() {
   // TODO: Freq 48000 some instruments anomalies on pkunk.mod, order 8
   // TODO: Change time per row to float
 
-  std::ifstream stream("ignore-mods/slyhome.mod");
+  if (argc > 1 && std::string(argv[1]) == "--batch") {
+    try {
+      return runBatch(argc, argv);
+    } catch (const std::exception &exception) {
+      std::cerr << exception.what() << std::endl;
+      return 1;
+    }
+  }
+
+  try {
+    const Options options = parseOptions(argc, argv);
 
-  //  MemoryStream stream((char *)modArray, modSize);
+    if (options.bench) {
+      return runBench(options);
+    }
 
-  playMod(stream);
+    if (!options.output.empty()) {
+      return renderToFile(options);
+    }
+
+#ifdef MODPLAYER_HEADLESS
+    std::cerr << "Built without audio playback, use --output or --bench"
+              << std::endl;
+    return 1;
+#else
+    playMod(options);
+#endif
+  } catch (const std::exception &exception) {
+    std::cerr << exception.what() << std::endl;
+    return 1;
+  }
 
   return 0;
 }
 
+#ifndef MODPLAYER_HEADLESS
+
 void fill_audio(void *udata, Uint8 *stream, int len) {
-  auto &generator = *(mod::Generator *)udata;
+  auto &playback = *(Playback *)udata;
+
+  if (!playback.threadPrepared) {
+    playback.threadPrepared = true;
+
+    // Mixing buffers are per thread, so they are prepared on audio thread.
+    playback.generator->reserveBuffer(len);
+
+    if (playback.realtime) {
+      mod::realtime::prefaultStack(playback.realtime->stackPrefaultSize);
 
-  generator.generate(stream, len);
+      if (!mod::realtime::lockGenerator(*playback.generator)) {
+        std::cout << "Could not lock generator buffers in memory, continuing "
+                     "unlocked"
+                  << std::endl;
+      }
+
+      if (!mod::realtime::promoteCurrentThread(*playback.realtime)) {
+        std::cout << "Could not set realtime priority, continuing with "
+                     "normal priority"
+                  << std::endl;
+      }
+    }
+  }
+
+  playback.generator->generate(stream, len);
 }
+
+#endif
@@ -44,4 +44,24 @@ std::string encodingToString(Encoding value) {
   }
 }
 
+Encoding encodingFromString(const std::string &value) {
+  if (value == "u8") {
+    return Encoding::Unsigned8;
+  }
+
+  if (value == "s8") {
+    return Encoding::Signed8;
+  }
+
+  if (value == "u16") {
+    return Encoding::Unsigned16;
+  }
+
+  if (value == "s16") {
+    return Encoding::Signed16;
+  }
+
+  throw std::invalid_argument("Unknown encoding: '" + value + "'");
+}
+
 }
\ No newline at end of file
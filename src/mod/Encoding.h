@@ -25,4 +25,10 @@ size_t bytesInEncoding(Encoding encoding);
 
 std::string encodingToString(Encoding value);
 
+/**
+ * @param value "u8", "s8", "u16" or "s16".
+ * @throws invalid_argument
+ */
+Encoding encodingFromString(const std::string &value);
+
 }
\ No newline at end of file
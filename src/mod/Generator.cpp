@@ -1,14 +1,31 @@
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
 #include <utility>
 
 #include "Generator.h"
+#include "ScratchPool.h"
 #include "exceptions/BadStateException.h"
 #include "loaders/DataConvertors.h"
 
 namespace mod {
 
+namespace {
+
+// Mixing buffer of block stays in cache while it is converted.
+constexpr size_t renderBlockFrames = 4096;
+
+ThreadPool &sharedDecodePool() {
+  static ThreadPool pool(1);
+
+  return pool;
+}
+
+}  // namespace
+
 #pragma region private
 
 bool Generator::advanceIndexes() {
@@ -16,7 +33,6 @@ bool Generator::advanceIndexes() {
     return false;
   }
 
-  const std::vector<Pattern> &patterns = this->_mod->getPatterns();
   const std::vector<int> &orders = this->_mod->getOrders();
 
   if (this->_currentOrderIndex >= this->_mod->getSongLength()) {
@@ -24,7 +40,7 @@ bool Generator::advanceIndexes() {
   }
 
   int currentOrder = orders[this->_currentOrderIndex];
-  const Pattern *currentPattern = &patterns[currentOrder];
+  const Pattern *currentPattern = &this->_mod->getPattern(currentOrder);
 
   if (this->_currentRowIndex + 1 >= currentPattern->getTotalRows()) {
     if (this->_currentOrderIndex + 1 >= this->_mod->getSongLength()) {
@@ -39,9 +55,8 @@ bool Generator::advanceIndexes() {
   return false;
 }
 
-void Generator::generateByChannel(std::vector<float> &data, size_t start,
-                                  size_t end, const Row &row,
-                                  size_t channelIndex) {
+void Generator::generateByChannel(float *data, size_t start, size_t end,
+                                  const Row &row, size_t channelIndex) {
   const Note &note = row.getNote(channelIndex);
   ChannelState &channelState = this->_channelsStates[channelIndex];
 
@@ -55,6 +70,20 @@ void Generator::generateByChannel(std::vector<float> &data, size_t start,
                            ((float)(note.samplePeriodFrequency) * 2.0f) /
                            (this->_frequency);
     }
+
+    const Sample &sample = this->_mod->getSample(note.sampleIndex - 1);
+
+    if (this->_renderCache != nullptr && sample.getRepeatLength() == 0) {
+      VoiceRenderCache::Key key{sample.getData().data(),
+                                sample.getData().size(),
+                                note.samplePeriodFrequency,
+                                sample.getFinetune(),
+                                this->_frequency,
+                                this->_interpolation};
+
+      channelState.render =
+          this->_renderCache->get(key, sample.getData(), channelState.pitch);
+    }
   }
 
   const auto &sampleIndex = channelState.sampleIndex;
@@ -63,8 +92,8 @@ void Generator::generateByChannel(std::vector<float> &data, size_t start,
     return;
   }
 
-  const Sample &sample = this->_mod->getSamples()[sampleIndex - 1];
-  const std::vector<float> &sampleData = sample.getData();
+  const Sample &sample = this->_mod->getSample(sampleIndex - 1);
+  const SampleData &sampleData = sample.getData();
 
   size_t dataIndex2 = 0;
 
@@ -74,9 +103,38 @@ void Generator::generateByChannel(std::vector<float> &data, size_t start,
 
   float sampleVolume = (float)sample.getVolume() / 64.0f * channelState.volume;
 
+  if (channelState.render != nullptr) {
+    const std::vector<float> &render = *channelState.render;
+    const float scale = sampleVolume / (float)this->_mod->getChannels();
+
+    if (data == nullptr) {
+      channelState.renderPosition =
+          std::min(render.size(), channelState.renderPosition + end - start);
+    }
+
+    for (auto i = start; data != nullptr && i < end &&
+                         channelState.renderPosition < render.size();
+         i++) {
+      data[i] += render[channelState.renderPosition] * scale;
+      channelState.renderPosition++;
+    }
+
+    if (channelState.renderPosition >= render.size()) {
+      channelState = {};
+    }
+
+    return;
+  }
+
+  if (data == nullptr) {
+    Generator::skipByChannel(channelState, sample, end - start);
+    return;
+  }
+
   for (auto i = start; i < end; i++) {
-    auto sampleDataIndex = (size_t)(channelState.sampleTime +
-                                    (float)dataIndex2 * channelState.pitch);
+    const float position =
+        channelState.sampleTime + (float)dataIndex2 * channelState.pitch;
+    auto sampleDataIndex = (size_t)position;
 
     if (sampleDataIndex >= sampleData.size()) {
       if (sample.getRepeatLength() == 0) {
@@ -91,8 +149,16 @@ void Generator::generateByChannel(std::vector<float> &data, size_t start,
       }
     }
 
-    data[i] += sampleData[sampleDataIndex] * sampleVolume /
-               (float)this->_mod->getChannels();
+    float value = sampleData[sampleDataIndex];
+
+    if (this->_interpolation == Interpolation::Linear &&
+        sampleDataIndex + 1 < sampleData.size()) {
+      const float fraction = position - (float)(size_t)position;
+
+      value += (sampleData[sampleDataIndex + 1] - value) * fraction;
+    }
+
+    data[i] += value * sampleVolume / (float)this->_mod->getChannels();
 
     dataIndex2++;
   }
@@ -104,13 +170,206 @@ void Generator::generateByChannel(std::vector<float> &data, size_t start,
   channelState.sampleTime += (float)dataIndex2 * channelState.pitch;
 }
 
+void Generator::skipByChannel(ChannelState &channelState,
+                              const Sample &sample, size_t frames) {
+  const size_t size = sample.getData().size();
+  // Same position expression as mixing, so results match bit for bit.
+  const auto isPastEnd = [&channelState, size](size_t dataIndex) {
+    return (size_t)(channelState.sampleTime +
+                    (float)dataIndex * channelState.pitch) >= size;
+  };
+
+  size_t dataIndex2 = 0;
+
+  while (frames > 0) {
+    // Positions only grow, so first frame past end is found by bisection.
+    size_t low = dataIndex2;
+    size_t high = dataIndex2 + frames;
+
+    while (low < high) {
+      const size_t middle = low + (high - low) / 2;
+
+      if (isPastEnd(middle)) {
+        high = middle;
+      } else {
+        low = middle + 1;
+      }
+    }
+
+    if (low == dataIndex2 + frames) {
+      dataIndex2 = low;
+      break;
+    }
+
+    if (sample.getRepeatLength() == 0) {
+      channelState = {};
+      return;
+    }
+
+    // Frame past end plays repeat point, following ones go on from it.
+    frames -= low - dataIndex2 + 1;
+    channelState.sampleTime = (float)sample.getRepeatPoint();
+    dataIndex2 = 1;
+  }
+
+  channelState.sampleTime += (float)dataIndex2 * channelState.pitch;
+}
+
+size_t Generator::renderFrames(float *data, size_t frames, float *stems) {
+  for (size_t current = 0; current < frames;) {
+    if (this->_availableOrderIndex != this->_currentOrderIndex) {
+      // Waits for decode pool instead of decoding on rendering thread. Data
+      // of streamed mod not received yet is waited for same way.
+      if (!this->_mod->isOrderDecoded(this->_currentOrderIndex)) {
+        if (!this->_prefetch.valid()) {
+          this->prefetchFrom(this->_currentOrderIndex);
+        } else if (this->_prefetch.wait_for(std::chrono::seconds(0)) ==
+                   std::future_status::ready) {
+          // Rethrows failure of decoding.
+          this->_prefetch.get();
+          this->prefetchFrom(this->_currentOrderIndex);
+        }
+
+        return current;
+      }
+
+      this->_availableOrderIndex = this->_currentOrderIndex;
+    }
+
+    const std::vector<int> &orders = this->_mod->getOrders();
+
+    int currentOrder = orders[this->_currentOrderIndex];
+    const Pattern &currentPattern = this->_mod->getPattern(currentOrder);
+
+    const Row &currentRow = currentPattern.getRow(this->_currentRowIndex);
+
+    if (!this->_rowPlayed) {
+      for (const auto &note : currentRow.getNotes()) {
+        if (note.effectNumber == 0xF) {
+          this->_timePerRow = this->calculateTimePerRow(this->_frequency, note.effectParameter);
+        }
+      }
+    }
+
+    // End of row is taken after its speed effect, so rows do not depend on
+    // where blocks of generate split them.
+    size_t next;
+    if (this->_timePassed % this->_timePerRow == 0) {
+      next = std::min(current + this->_timePerRow, frames);
+    } else {
+      next = std::min(
+          current + this->_timePerRow - this->_timePassed % this->_timePerRow,
+          frames);
+    }
+
+    for (auto channelIndex = 0;
+         !this->_timingOnly && channelIndex < this->_mod->getChannels();
+         channelIndex++) {
+      if (this->_mutedChannels[channelIndex]) {
+        continue;
+      }
+
+      float *target =
+          stems != nullptr ? stems + channelIndex * frames : data;
+
+      this->generateByChannel(target, current, next, currentRow,
+                              channelIndex);
+    }
+
+    this->_rowPlayed = true;
+
+    if ((this->_timePassed % this->_timePerRow) + (next - current) >=
+        this->_timePerRow) {
+      this->_rowPlayed = false;
+      if (this->advanceIndexes()) {
+        if (++this->_loopsPlayed >= this->_loopCount) {
+          this->pause();
+          return next;
+        }
+
+        this->_setOrderAndRowIndex(0, 0);
+      }
+    }
+    this->_timePassed += next - current;
+
+    current = next;
+  }
+
+  return frames;
+}
+
+void Generator::checkRange(const char *caller, size_t fromFrame,
+                           size_t toFrame) const {
+  if (this->_convertor == nullptr) {
+    throw BadStateException(
+        fmt::format("{}: Audio encoding was not set.", caller));
+  }
+
+  if (this->_mod == nullptr) {
+    throw BadStateException(fmt::format("{}: Mod was not set.", caller));
+  }
+
+  if (fromFrame > toFrame) {
+    throw std::invalid_argument(fmt::format(
+        "{}: Range start {} is after its end {}.", caller, fromFrame, toFrame));
+  }
+}
+
+size_t Generator::renderBlocks(const char *caller, size_t fromFrame,
+                               size_t toFrame, uint8_t *data) {
+  this->restart();
+
+  const size_t firstMixedBlock =
+      fromFrame / renderBlockFrames * renderBlockFrames;
+
+  for (size_t block = 0; block < toFrame; block += renderBlockFrames) {
+    const size_t frames = std::min(renderBlockFrames, toFrame - block);
+    float *buffer = block >= firstMixedBlock
+                        ? ScratchPool::acquire(frames).data()
+                        : nullptr;
+    size_t rendered = 0;
+
+    while (rendered < frames &&
+           this->_generatorState != GeneratorState::Paused) {
+      rendered += this->renderFrames(
+          buffer != nullptr ? buffer + rendered : nullptr, frames - rendered);
+
+      if (rendered == frames ||
+          this->_generatorState == GeneratorState::Paused) {
+        break;
+      }
+
+      // Decodes here instead of waiting for decode pool.
+      if (!this->_mod->prefetch(this->_currentOrderIndex)) {
+        throw BadStateException(
+            fmt::format("{}: Mod data was not received yet.", caller));
+      }
+    }
+
+    if (rendered < frames) {
+      return block + rendered;
+    }
+
+    // Frames before range only bring channels to their state.
+    const size_t skipped = fromFrame > block ? fromFrame - block : 0;
+
+    for (size_t i = skipped; buffer != nullptr && i < frames; i++) {
+      this->_convertor(
+          std::min(1.0f, std::max(-1.0f, buffer[i] * this->_volume)), data);
+      data += this->_bytesInEncoding;
+    }
+  }
+
+  return toFrame;
+}
+
 void Generator::resetState() {
   for (auto &state : this->_channelsStates) {
     state = {};
   }
 }
 
-size_t Generator::calculateTimePerRow(float frequency, float speed) {
+size_t Generator::calculateTimePerRow(float frequency, float speed) const {
   return (size_t)(441.5f * speed / (11025.0f * 2.0f) * frequency);
 }
 
@@ -119,17 +378,18 @@ void Generator::_setState(GeneratorState newState) {
     return;
   }
 
-  if (this->_stateChangedCallback != nullptr) {
+  if (this->_callbacks != nullptr &&
+      this->_callbacks->stateChanged != nullptr) {
     ChangedValue<GeneratorState> state(this->_generatorState, newState);
 
-    this->_stateChangedCallback(*this, ChangedStateEvent(state));
+    this->_callbacks->stateChanged(*this, ChangedStateEvent(state));
   }
 
   this->_generatorState = newState;
 }
 
 void Generator::_setRowIndex(size_t newRowIndex) {
-  if (this->_nextRowCallback != nullptr) {
+  if (this->_callbacks != nullptr && this->_callbacks->nextRow != nullptr) {
     const std::vector<int> &orders = this->_mod->getOrders();
     const int &patternIndex = orders[this->_currentOrderIndex];
     ChangedValue<size_t> changedRow(this->_currentRowIndex, newRowIndex);
@@ -139,14 +399,14 @@ void Generator::_setRowIndex(size_t newRowIndex) {
 
     this->_currentRowIndex = newRowIndex;
 
-    this->_nextRowCallback(*this, event);
+    this->_callbacks->nextRow(*this, event);
   } else {
     this->_currentRowIndex = newRowIndex;
   }
 }
 
 void Generator::_setOrderIndex(size_t newOrderIndex) {
-  if (this->_nextOrderCallback != nullptr) {
+  if (this->_callbacks != nullptr && this->_callbacks->nextOrder != nullptr) {
     const std::vector<int> &orders = this->_mod->getOrders();
 
     const int &oldPatternIndex = orders[this->_currentOrderIndex];
@@ -158,14 +418,16 @@ void Generator::_setOrderIndex(size_t newOrderIndex) {
 
     this->_currentOrderIndex = newOrderIndex;
 
-    this->_nextOrderCallback(*this, event);
+    this->_callbacks->nextOrder(*this, event);
   } else {
     this->_currentOrderIndex = newOrderIndex;
   }
 }
 
 void Generator::_setOrderAndRowIndex(size_t newOrderIndex, size_t newRowIndex) {
-  if (this->_nextOrderCallback != nullptr || this->_nextRowCallback != nullptr) {
+  if (this->_callbacks != nullptr &&
+      (this->_callbacks->nextOrder != nullptr ||
+       this->_callbacks->nextRow != nullptr)) {
     const std::vector<int> &orders = this->_mod->getOrders();
 
     const int &oldPatternIndex = orders[this->_currentOrderIndex];
@@ -178,16 +440,16 @@ void Generator::_setOrderAndRowIndex(size_t newOrderIndex, size_t newRowIndex) {
     this->_currentOrderIndex = newOrderIndex;
     this->_currentRowIndex = newRowIndex;
 
-    if (this->_nextOrderCallback != nullptr) {
+    if (this->_callbacks->nextOrder != nullptr) {
       ChangedOrderEvent event(changedRow, changedOrder, changedPattern);
 
-      this->_nextOrderCallback(*this, event);
+      this->_callbacks->nextOrder(*this, event);
     }
 
-    if (this->_nextRowCallback != nullptr) {
+    if (this->_callbacks->nextRow != nullptr) {
       ChangedRowEvent event(changedRow, changedOrder, changedPattern);
 
-      this->_nextRowCallback(*this, event);
+      this->_callbacks->nextRow(*this, event);
     }
   } else {
     this->_currentOrderIndex = newOrderIndex;
@@ -195,16 +457,43 @@ void Generator::_setOrderAndRowIndex(size_t newOrderIndex, size_t newRowIndex) {
   }
 }
 
+void Generator::prefetchFrom(size_t orderIndex) {
+  if (this->_mod == nullptr || !this->_mod->isLazy()) {
+    return;
+  }
+
+  ThreadPool &pool = this->_decodePool != nullptr ? *this->_decodePool
+                                                  : sharedDecodePool();
+
+  this->_prefetch = pool.submit([mod = this->_mod, orderIndex]() {
+    // Rest of streamed mod is queued again when generator reaches it.
+    size_t i = orderIndex;
+
+    while (i < mod->getSongLength() && mod->prefetch(i)) {
+      i++;
+    }
+  });
+}
+
+Generator::Callbacks &Generator::getCallbacks() {
+  if (this->_callbacks == nullptr) {
+    this->_callbacks = std::make_unique<Callbacks>();
+  }
+
+  return *this->_callbacks;
+}
+
 #pragma endregion
 
 #pragma region public constructor
 
-Generator::Generator(std::shared_ptr<Mod> mod, Encoding audioDataEncoding)
+Generator::Generator(std::shared_ptr<const Mod> mod, Encoding audioDataEncoding)
     : _mod(std::move(mod)), _audioDataEncoding(audioDataEncoding) {
   this->_channelsStates.resize(this->_mod->getChannels());
   this->_mutedChannels.resize(this->_mod->getChannels(), false);
 
   this->setEncoding(audioDataEncoding);
+  this->prefetchFrom(0);
 }
 
 #pragma endregion
@@ -214,19 +503,19 @@ Generator::Generator(std::shared_ptr<Mod> mod, Encoding audioDataEncoding)
 void Generator::setNextRowCallback(
     std::function<void(Generator &, ChangedRowEvent event)>
         callback) {
-  this->_nextRowCallback = std::move(callback);
+  this->getCallbacks().nextRow = std::move(callback);
 }
 
 void Generator::setNextOrderCallback(
     std::function<void(mod::Generator &generator, ChangedOrderEvent event)>
         callback) {
-  this->_nextOrderCallback = std::move(callback);
+  this->getCallbacks().nextOrder = std::move(callback);
 }
 
 void Generator::setStateChangedCallback(
     std::function<void(Generator &, ChangedStateEvent event)>
         callback) {
-  this->_stateChangedCallback = std::move(callback);
+  this->getCallbacks().stateChanged = std::move(callback);
 }
 
 void Generator::setVolume(float volume) { this->_volume = volume; }
@@ -244,65 +533,113 @@ void Generator::setFrequency(float frequency) {
   this->_frequency = frequency;
 }
 
-void Generator::setMod(std::shared_ptr<Mod> mod) {
+float Generator::getFrequency() const { return this->_frequency; }
+
+void Generator::setMod(std::shared_ptr<const Mod> mod) {
   this->_mod = std::move(mod);
   this->_channelsStates.resize(this->_mod->getChannels());
+  this->_mutedChannels.resize(this->_mod->getChannels(), false);
+  this->_availableOrderIndex = SIZE_MAX;
 
   this->resetState();
+  this->prefetchFrom(this->_currentOrderIndex);
 }
 
-std::shared_ptr<Mod> Generator::getMod() { return this->_mod; }
+void Generator::setDecodePool(std::shared_ptr<ThreadPool> decodePool) {
+  this->_decodePool = std::move(decodePool);
 
-std::shared_ptr<const Mod> Generator::getMod() const { return this->_mod; }
+  this->prefetchFrom(this->_currentOrderIndex);
+}
 
-Row &Generator::getRow(size_t index) {
-  if (this->_mod == nullptr) {
-    throw BadStateException("Mod was not set.");
-  }
+std::shared_ptr<ThreadPool> Generator::getDecodePool() const {
+  return this->_decodePool;
+}
 
-  Pattern &pattern = this->getCurrentPattern();
+void Generator::setInterpolation(Interpolation interpolation) {
+  this->_interpolation = interpolation;
+}
 
-  return pattern.getRow(index);
+Interpolation Generator::getInterpolation() const {
+  return this->_interpolation;
 }
 
-const Row &Generator::getRow(size_t index) const {
-  if (this->_mod == nullptr) {
-    throw BadStateException("Mod was not set.");
+void Generator::setLoopCount(size_t loopCount) {
+  if (loopCount == 0) {
+    throw std::invalid_argument("setLoopCount: Loop count must be above 0.");
   }
 
-  const Pattern &pattern = this->getCurrentPattern();
+  this->_loopCount = loopCount;
+}
 
-  return pattern.getRow(index);
+size_t Generator::getLoopCount() const { return this->_loopCount; }
+
+void Generator::setRenderCache(std::shared_ptr<VoiceRenderCache> renderCache) {
+  this->_renderCache = std::move(renderCache);
+
+  for (auto &state : this->_channelsStates) {
+    if (state.render != nullptr) {
+      state.sampleTime = (float)state.renderPosition * state.pitch;
+      state.render = nullptr;
+      state.renderPosition = 0;
+    }
+  }
 }
 
-Row &Generator::getCurrentRow() {
-  if (this->_mod == nullptr) {
-    throw BadStateException("Mod was not set.");
+std::shared_ptr<VoiceRenderCache> Generator::getRenderCache() const {
+  return this->_renderCache;
+}
+
+void Generator::reserveBuffer(size_t size) {
+  if (this->_convertor == nullptr) {
+    throw BadStateException("reserveBuffer: Audio encoding was not set.");
   }
 
-  Pattern &pattern = this->getCurrentPattern();
+  ScratchPool::reserve(size / this->_bytesInEncoding);
+}
 
-  return pattern.getRow(this->_currentRowIndex);
+std::shared_ptr<const Mod> Generator::getMod() const { return this->_mod; }
+
+MemoryUsage Generator::memoryUsage() const {
+  MemoryUsage usage;
+
+  usage.generatorState += sizeof(Generator);
+  usage.generatorState +=
+      this->_channelsStates.capacity() * sizeof(ChannelState);
+  usage.generatorState += (this->_mutedChannels.capacity() + 7) / 8;
+
+  if (this->_callbacks != nullptr) {
+    usage.generatorState += sizeof(Callbacks);
+  }
+
+  usage.buffers += ScratchPool::peek().capacity() * sizeof(float);
+  // Stems buffer of generateStems.
+  usage.buffers += ScratchPool::peek(1).capacity() * sizeof(float);
+
+  if (this->_renderCache != nullptr) {
+    usage.caches += this->_renderCache->getSize();
+  }
+
+  return usage;
 }
 
-const Row &Generator::getCurrentRow() const {
+const Row &Generator::getRow(size_t index) const {
   if (this->_mod == nullptr) {
     throw BadStateException("Mod was not set.");
   }
 
   const Pattern &pattern = this->getCurrentPattern();
 
-  return pattern.getRow(this->_currentRowIndex);
+  return pattern.getRow(index);
 }
 
-Pattern &Generator::getCurrentPattern() {
+const Row &Generator::getCurrentRow() const {
   if (this->_mod == nullptr) {
     throw BadStateException("Mod was not set.");
   }
 
-  const int &patternIndex = this->_mod->getOrders()[this->_currentOrderIndex];
+  const Pattern &pattern = this->getCurrentPattern();
 
-  return this->_mod->getPatterns()[patternIndex];
+  return pattern.getRow(this->_currentRowIndex);
 }
 
 const Pattern &Generator::getCurrentPattern() const {
@@ -312,7 +649,7 @@ const Pattern &Generator::getCurrentPattern() const {
 
   const int &patternIndex = this->_mod->getOrders()[this->_currentOrderIndex];
 
-  return this->_mod->getPatterns()[patternIndex];
+  return this->_mod->getPattern(patternIndex);
 }
 
 void Generator::stop() {
@@ -320,6 +657,7 @@ void Generator::stop() {
   this->_setOrderAndRowIndex(0, 0);
   this->_timePassed = 0;
   this->_rowPlayed = false;
+  this->_loopsPlayed = 0;
 }
 
 void Generator::restart() {
@@ -327,6 +665,47 @@ void Generator::restart() {
   this->_setOrderAndRowIndex(0, 0);
   this->_timePassed = 0;
   this->_rowPlayed = false;
+  this->_loopsPlayed = 0;
+}
+
+size_t Generator::countFrames() const {
+  if (this->_mod == nullptr) {
+    throw BadStateException("countFrames: Mod was not set.");
+  }
+
+  constexpr size_t blockFrames = 1 << 16;
+
+  for (size_t i = 0; this->_mod->isLazy() && i < this->_mod->getSongLength();
+       i++) {
+    if (!this->_mod->prefetch(i)) {
+      throw BadStateException("countFrames: Mod data was not received yet.");
+    }
+  }
+
+  // Fresh generator without callbacks and mixing only walks song timing.
+  Generator dryRun;
+
+  dryRun._mod = this->_mod;
+  dryRun._frequency = this->_frequency;
+  // Restart keeps speed, so does dry run.
+  dryRun._timePerRow = this->_timePerRow;
+  dryRun._loopCount = this->_loopCount;
+  dryRun._timingOnly = true;
+
+  size_t total = 0;
+
+  while (dryRun._generatorState != GeneratorState::Paused) {
+    const size_t rendered = dryRun.renderFrames(nullptr, blockFrames);
+
+    total += rendered;
+
+    if (rendered < blockFrames &&
+        dryRun._generatorState != GeneratorState::Paused) {
+      throw BadStateException("countFrames: Mod data was not received yet.");
+    }
+  }
+
+  return total;
 }
 
 void Generator::pause() { this->_setState(GeneratorState::Paused); }
@@ -350,70 +729,125 @@ void Generator::generate(uint8_t *data, size_t size) {
     return;
   }
 
-  if (this->_buffer.size() != (size / this->_bytesInEncoding)) {
-    this->_buffer.resize(size / this->_bytesInEncoding);
+  std::vector<float> &buffer =
+      ScratchPool::acquire(size / this->_bytesInEncoding);
+
+  this->renderFrames(buffer.data(), buffer.size());
+
+  uint8_t *dataPtr = data;
+  for (const float &i : buffer) {
+    this->_convertor(std::min(1.0f, std::max(-1.0f, i * this->_volume)),
+                     dataPtr);
+    //    this->_convertor(0.5f,
+    //                     dataPtr);
+    dataPtr += this->_bytesInEncoding;
   }
+}
 
-  for (size_t current = 0; current < this->_buffer.size();) {
-    size_t next;
-    if (this->_timePassed % this->_timePerRow == 0) {
-      next = std::min(current + this->_timePerRow, this->_buffer.size());
-    } else {
-      next = std::min(this->_timePerRow - this->_timePassed % this->_timePerRow,
-                      this->_buffer.size());
-    }
+void Generator::generateStems(uint8_t *mix, const std::vector<uint8_t *> &stems,
+                              size_t size) {
+  if (this->_convertor == nullptr) {
+    throw BadStateException("generateStems: Audio encoding was not set.");
+  }
 
-    const std::vector<Pattern> &patterns = this->_mod->getPatterns();
-    const std::vector<int> &orders = this->_mod->getOrders();
+  if (this->_mod == nullptr) {
+    throw BadStateException("generateStems: Mod was not set.");
+  }
 
-    int currentOrder = orders[this->_currentOrderIndex];
-    const Pattern &currentPattern = patterns[currentOrder];
+  const size_t channels = this->_mod->getChannels();
 
-    const Row &currentRow = currentPattern.getRow(this->_currentRowIndex);
+  if (stems.size() != channels) {
+    throw std::invalid_argument(
+        fmt::format("generateStems: Got {} stems for {} channels.",
+                    stems.size(), channels));
+  }
 
-    if (!this->_rowPlayed) {
-      for (const auto &note : currentRow.getNotes()) {
-        if (note.effectNumber == 0xF) {
-          this->_timePerRow = this->calculateTimePerRow(this->_frequency, note.effectParameter);
-        }
-      }
-    }
+  const size_t frames = size / this->_bytesInEncoding;
 
-    for (auto channelIndex = 0; channelIndex < this->_mod->getChannels();
-         channelIndex++) {
-      if (this->_mutedChannels[channelIndex]) {
-        continue;
-      }
+  // Stays zeroed when paused, so paused generator gives silence.
+  std::vector<float> &stemsBuffer = ScratchPool::acquire(frames * channels, 1);
 
-      this->generateByChannel(this->_buffer, current, next, currentRow,
-                              channelIndex);
+  if (this->_generatorState != GeneratorState::Paused) {
+    this->renderFrames(nullptr, frames, stemsBuffer.data());
+  }
+
+  const auto convert = [this, frames](const float *source, uint8_t *target) {
+    for (size_t i = 0; i < frames; i++) {
+      this->_convertor(
+          std::min(1.0f, std::max(-1.0f, source[i] * this->_volume)), target);
+      target += this->_bytesInEncoding;
     }
+  };
 
-    this->_rowPlayed = true;
+  for (size_t channelIndex = 0; channelIndex < channels; channelIndex++) {
+    if (stems[channelIndex] != nullptr) {
+      convert(stemsBuffer.data() + channelIndex * frames, stems[channelIndex]);
+    }
+  }
 
-    if ((this->_timePassed % this->_timePerRow) + (next - current) >=
-        this->_timePerRow) {
-      this->_rowPlayed = false;
-      if (this->advanceIndexes()) {
-        this->pause();
-        break;
-      }
+  if (mix == nullptr) {
+    return;
+  }
+
+  std::vector<float> &mixBuffer = ScratchPool::acquire(frames);
+
+  // Channels are added in same order as generate mixes them, so mix is
+  // exactly the same.
+  for (size_t channelIndex = 0; channelIndex < channels; channelIndex++) {
+    const float *stem = stemsBuffer.data() + channelIndex * frames;
+
+    for (size_t i = 0; i < frames; i++) {
+      mixBuffer[i] += stem[i];
     }
-    this->_timePassed += next - current;
+  }
 
-    current = next;
+  convert(mixBuffer.data(), mix);
+}
+
+std::vector<uint8_t> Generator::renderAll() {
+  if (this->_convertor == nullptr) {
+    throw BadStateException("renderAll: Audio encoding was not set.");
   }
 
-  uint8_t *dataPtr = data;
-  for (const float &i : this->_buffer) {
-    this->_convertor(std::min(1.0f, std::max(-1.0f, i * this->_volume)),
-                     dataPtr);
-    //    this->_convertor(0.5f,
-    //                     dataPtr);
-    dataPtr += this->_bytesInEncoding;
+  const size_t frames = this->countFrames();
+  std::vector<uint8_t> data(frames * this->_bytesInEncoding);
+
+  this->renderBlocks("renderAll", 0, frames, data.data());
+
+  return data;
+}
+
+std::vector<uint8_t> Generator::renderRange(size_t fromFrame, size_t toFrame) {
+  this->checkRange("renderRange", fromFrame, toFrame);
+
+  std::vector<uint8_t> data((toFrame - fromFrame) * this->_bytesInEncoding);
+
+  this->renderRange(fromFrame, toFrame, data.data(), data.size());
+
+  return data;
+}
+
+size_t Generator::renderRange(size_t fromFrame, size_t toFrame, uint8_t *data,
+                              size_t size) {
+  this->checkRange("renderRange", fromFrame, toFrame);
+
+  const size_t needed = (toFrame - fromFrame) * this->_bytesInEncoding;
+
+  if (size < needed) {
+    throw std::invalid_argument(fmt::format(
+        "renderRange: Range needs {} bytes, got {}.", needed, size));
+  }
+
+  const size_t rendered =
+      this->renderBlocks("renderRange", fromFrame, toFrame, data);
+
+  if (rendered < toFrame) {
+    throw std::out_of_range(
+        fmt::format("renderRange: Frame {} is past end of song {}.", toFrame,
+                    rendered));
   }
 
-  std::memset(this->_buffer.data(), 0, this->_buffer.size() * sizeof(float));
+  return needed;
 }
 
 void Generator::setEncoding(Encoding audioDataEncoding) {
@@ -464,6 +898,7 @@ void Generator::setCurrentOrder(size_t index) {
 
   this->resetState();
   this->_setOrderIndex(index);
+  this->prefetchFrom(index);
 }
 
 void Generator::setCurrentRow(size_t index) {
@@ -472,7 +907,7 @@ void Generator::setCurrentRow(size_t index) {
   }
 
   const auto &patternIndex = this->_mod->getOrders()[this->_currentOrderIndex];
-  const auto &pattern = this->_mod->getPatterns()[patternIndex];
+  const auto &pattern = this->_mod->getPattern(patternIndex);
 
   if (index >= pattern.getTotalRows()) {
     const std::string message = fmt::format(
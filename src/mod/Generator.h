@@ -1,13 +1,26 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <future>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "Interpolation.h"
+#include "ThreadPool.h"
 #include "Mod.h"
+#include "VoiceRenderCache.h"
 
 namespace mod {
 
+class Generator;
+
+namespace realtime {
+bool lockGenerator(const Generator &generator);
+void unlockGenerator(const Generator &generator);
+}  // namespace realtime
+
 enum class GeneratorState {
   Playing = 0,
   Paused,
@@ -51,40 +64,74 @@ struct ChangedStateEvent {
       : state(inState) {}
 };
 
-class Generator {
+/**
+ * Generators only read the mod, so many generators on different threads may
+ * share one. Mixing buffers are borrowed from ScratchPool of rendering
+ * thread. Aligned to cache line, so generators rendered by different
+ * threads do not share one.
+ */
+class alignas(64) Generator {
  private:
+  friend bool realtime::lockGenerator(const Generator &generator);
+  friend void realtime::unlockGenerator(const Generator &generator);
+
   struct ChannelState {
     size_t sampleIndex = 0;
     float sampleTime = 0.0f;
     float volume = 1.0f;
     float pitch = 1.0f;
+    // Set when one-shot trigger is played from render cache.
+    VoiceRenderCache::Render render = nullptr;
+    size_t renderPosition = 0;
+  };
+
+  struct Callbacks {
+    std::function<void(Generator &, ChangedRowEvent event)> nextRow = nullptr;
+    std::function<void(Generator &, ChangedOrderEvent event)> nextOrder =
+        nullptr;
+    std::function<void(Generator &, ChangedStateEvent event)> stateChanged =
+        nullptr;
   };
 
-  std::shared_ptr<Mod> _mod = nullptr;
+  std::shared_ptr<const Mod> _mod = nullptr;
   std::vector<ChannelState> _channelsStates;
   std::vector<bool> _mutedChannels;
-  std::vector<float> _buffer;
+  // Allocated only when a callback is set.
+  std::unique_ptr<Callbacks> _callbacks = nullptr;
+  std::shared_ptr<VoiceRenderCache> _renderCache = nullptr;
+  std::shared_ptr<ThreadPool> _decodePool = nullptr;
+  // Last queued decoding of parts of lazy mod.
+  std::future<void> _prefetch;
 
-  bool _rowPlayed = false;
-  size_t _timePassed = 0.0f;
+  void (*_convertor)(const float &value, uint8_t *target) = nullptr;
+
+  size_t _timePassed = 0;
   size_t _timePerRow = 440.0f * 6.0f;
   size_t _currentOrderIndex = 0;
   size_t _currentRowIndex = 0;
+  // Order whose data was confirmed received, SIZE_MAX if none.
+  size_t _availableOrderIndex = SIZE_MAX;
+  size_t _loopCount = 1;
+  size_t _loopsPlayed = 0;
   size_t _bytesInEncoding = 1;
   float _volume = 1.0f;
   float _frequency = 22050.0f;
-
-  std::function<void(Generator &, ChangedRowEvent event)> _nextRowCallback =
-      nullptr;
-  std::function<void(Generator &, ChangedOrderEvent event)> _nextOrderCallback =
-      nullptr;
-  std::function<void(Generator &, ChangedStateEvent event)>
-      _stateChangedCallback = nullptr;
+  bool _rowPlayed = false;
+  // Set on dry run of countFrames, which does not touch channels.
+  bool _timingOnly = false;
 
   GeneratorState _generatorState = GeneratorState::Playing;
   Encoding _audioDataEncoding = Encoding::Unknown;
+  Interpolation _interpolation = Interpolation::Nearest;
 
-  void (*_convertor)(const float &value, uint8_t *target) = nullptr;
+  Callbacks &getCallbacks();
+
+  /**
+   * Decodes patterns and samples of lazily loaded mod on decode pool, or
+   * shared pool if it is not set, in play order starting at orderIndex.
+   * @param orderIndex
+   */
+  void prefetchFrom(size_t orderIndex);
 
   /**
    * Advance current order and current row indexes.
@@ -92,12 +139,60 @@ class Generator {
    */
   bool advanceIndexes();
 
-  void generateByChannel(std::vector<float> &data, size_t start, size_t end,
+  /**
+   * @param data Frames to mix channel into, or nullptr to only move channel
+   * as mixing would.
+   * @param start
+   * @param end
+   * @param row
+   * @param channelIndex
+   */
+  void generateByChannel(float *data, size_t start, size_t end,
                          const Row &row, size_t channelIndex);
 
+  /**
+   * Moves sample position by frames, finding loop ends by binary search
+   * instead of stepping every frame. Ends up same as mixing frames.
+   * @param channelState
+   * @param sample
+   * @param frames
+   */
+  static void skipByChannel(ChannelState &channelState, const Sample &sample,
+                            size_t frames);
+
+  /**
+   * Mixes frames into data, advancing song position.
+   * @param data Zeroed frames, or nullptr to only advance song and channel
+   * positions without mixing.
+   * @param frames
+   * @param stems If set, zeroed frames of each channel one after another,
+   * channels are rendered there instead of into data.
+   * @return Frames of song rendered. Less than frames if end of song was
+   * reached or data of current order was not received yet.
+   */
+  size_t renderFrames(float *data, size_t frames, float *stems = nullptr);
+
+  /**
+   * @throws BadStateException If encoding or mod was not set.
+   * @throws invalid_argument If fromFrame is after toFrame.
+   */
+  void checkRange(const char *caller, size_t fromFrame, size_t toFrame) const;
+
+  /**
+   * Restarts and renders song up to toFrame in fixed blocks, converting
+   * frames from fromFrame on into data. Blocks before the one holding
+   * fromFrame are skipped without mixing. Blocks always start at multiples
+   * of block size, so range is same as that part of whole song. Orders of
+   * lazily loaded mod are decoded on calling thread when reached.
+   * @return Frames of song rendered, less than toFrame if song ended first.
+   * @throws BadStateException If data of mod was not received yet.
+   */
+  size_t renderBlocks(const char *caller, size_t fromFrame, size_t toFrame,
+                      uint8_t *data);
+
   void resetState();
 
-  size_t calculateTimePerRow(float frequency, float speed);
+  size_t calculateTimePerRow(float frequency, float speed) const;
 
   void _setState(GeneratorState newState);
 
@@ -113,7 +208,7 @@ class Generator {
    * @param audioDataEncoding
    * @throws invalid_argument
    */
-  Generator(std::shared_ptr<Mod> mod, Encoding audioDataEncoding);
+  Generator(std::shared_ptr<const Mod> mod, Encoding audioDataEncoding);
 
   Generator() = default;
 
@@ -145,19 +240,56 @@ class Generator {
    */
   void setFrequency(float frequency);
 
-  void setMod(std::shared_ptr<Mod> mod);
+  [[nodiscard]] float getFrequency() const;
+
+  void setMod(std::shared_ptr<const Mod> mod);
+
+  void setInterpolation(Interpolation interpolation);
 
-  std::shared_ptr<Mod> getMod();
+  [[nodiscard]] Interpolation getInterpolation() const;
+
+  /**
+   * @param loopCount Times song is played before generator pauses. Song
+   * restarts from first order without resetting channels, as in loop.
+   * @throws invalid_argument If 0.
+   */
+  void setLoopCount(size_t loopCount);
+
+  [[nodiscard]] size_t getLoopCount() const;
+
+  /**
+   * @param renderCache If set, triggers of non looping samples are played
+   * from cached renders. May be shared between generators.
+   */
+  void setRenderCache(std::shared_ptr<VoiceRenderCache> renderCache);
+
+  [[nodiscard]] std::shared_ptr<VoiceRenderCache> getRenderCache() const;
+
+  /**
+   * Parts of lazily loaded mod are decoded on decode pool ahead of playback,
+   * when mod or current order is set. Generate never decodes them itself.
+   * @param decodePool If nullptr, pool of one thread shared by all
+   * generators is used.
+   */
+  void setDecodePool(std::shared_ptr<ThreadPool> decodePool);
+
+  [[nodiscard]] std::shared_ptr<ThreadPool> getDecodePool() const;
+
+  /**
+   * Allocates mixing buffer of calling thread ahead of time, so generate
+   * with same size on this thread does not allocate.
+   * @param size Size in bytes of data passed to generate.
+   * @throws BadStateException If encoding was not set.
+   */
+  void reserveBuffer(size_t size);
 
   [[nodiscard]] std::shared_ptr<const Mod> getMod() const;
 
   /**
-   * @throws out_of_range If index is out of range for current pattern.
-   * @throws BadStateException If mod file was not set.
-   * @param index
-   * @return
+   * Mod is not included, as it may be shared with other generators.
+   * @return Memory held by generator and mixing buffer of calling thread.
    */
-  Row &getRow(size_t index);
+  [[nodiscard]] MemoryUsage memoryUsage() const;
 
   /**
    * @throws out_of_range If index is out of range for current pattern.
@@ -167,12 +299,6 @@ class Generator {
    */
   [[nodiscard]] const Row &getRow(size_t index) const;
 
-  /**
-   * @throws BadStateException If mod file was not set.
-   * @return
-   */
-  Row &getCurrentRow();
-
   /**
    * @throws BadStateException If mod file was not set.
    * @return
@@ -183,13 +309,18 @@ class Generator {
    * @throws BadStateException If mod file was not set.
    * @return
    */
-  Pattern &getCurrentPattern();
+  [[nodiscard]] const Pattern &getCurrentPattern() const;
 
   /**
-   * @throws BadStateException If mod file was not set.
-   * @return
+   * Walks song timing from start without mixing. Does not change state of
+   * generator. Parts of lazily loaded mod played by song are decoded on
+   * calling thread, so generate does not wait for their decoding.
+   * @return Exact number of frames generate produces after restart, before
+   * pausing at end of last loop of song.
+   * @throws BadStateException If mod was not set or its data was not
+   * received yet.
    */
-  [[nodiscard]] const Pattern &getCurrentPattern() const;
+  [[nodiscard]] size_t countFrames() const;
 
   void stop();
   void restart();
@@ -197,12 +328,67 @@ class Generator {
   void start();
 
   /**
+   * If data of current order of streamed mod was not received yet, or
+   * current order of lazily loaded mod was not decoded yet, rest of data is
+   * silence and playback position does not move.
    * @param data
    * @param size
    * @throws BadStateException If encoding or mod was not set.
    */
   void generate(uint8_t *data, size_t size);
 
+  /**
+   * Renders every channel into its own target in same pass as mix. Channels
+   * keep their share of mix level, so stems add up to mix before clipping.
+   * Mix is same as generate would produce. Muted channels are silent.
+   * @param mix Size bytes, or nullptr if mix is not needed.
+   * @param stems Target of size bytes for each channel of mod. Null entries
+   * are rendered but not converted.
+   * @param size
+   * @throws invalid_argument If stems do not match channels of mod.
+   * @throws BadStateException If encoding or mod was not set.
+   */
+  void generateStems(uint8_t *mix, const std::vector<uint8_t *> &stems,
+                     size_t size);
+
+  /**
+   * Renders whole song from start into buffer of exact size, allocated once.
+   * Generator is left paused at end of song.
+   * @return Frames in encoding of generator.
+   * @throws BadStateException If encoding or mod was not set, or data of mod
+   * was not received yet.
+   */
+  std::vector<uint8_t> renderAll();
+
+  /**
+   * Renders frames [fromFrame, toFrame) of song. Song is played from start,
+   * so channels sound same as in whole song, but frames before fromFrame
+   * are not mixed: song timing is walked and sample positions are moved a
+   * step per loop of sample, row and block of 4096 frames. Song is not
+   * counted first, end of song is found by rendering up to it. Generator is
+   * left at toFrame.
+   * @param fromFrame
+   * @param toFrame At most countFrames.
+   * @return Frames in encoding of generator.
+   * @throws BadStateException If encoding or mod was not set, or data of mod
+   * was not received yet.
+   * @throws invalid_argument If fromFrame is after toFrame.
+   * @throws out_of_range If toFrame is past end of song.
+   */
+  std::vector<uint8_t> renderRange(size_t fromFrame, size_t toFrame);
+
+  /**
+   * Same as renderRange, into buffer of caller.
+   * @param fromFrame
+   * @param toFrame
+   * @param data
+   * @param size Size of data in bytes, at least frames of range.
+   * @return Bytes written.
+   * @throws invalid_argument If data is too small.
+   */
+  size_t renderRange(size_t fromFrame, size_t toFrame, uint8_t *data,
+                     size_t size);
+
   /**
    * @param audioDataEncoding
    * @throws invalid_argument If passed unsupported encoding.
@@ -40,6 +40,26 @@ std::string InfoString::toString(const Mod& mod) {
       mod.getSampleCount(), mod.getPatternCount());
 }
 
+std::string InfoString::toString(const MemoryUsage& usage) {
+  return fmt::format(
+      "Samples: {} bytes ({} shared)\nPatterns: {} bytes\nOrders: {} bytes\n"
+      "Metadata: {} bytes\nGenerator state: {} bytes\nBuffers: {} bytes\n"
+      "Caches: {} bytes\nTotal: {} bytes",
+      usage.samples, usage.sharedSamples, usage.patterns, usage.orders,
+      usage.metadata, usage.generatorState, usage.buffers, usage.caches,
+      usage.total());
+}
+
+std::string InfoString::toJson(const MemoryUsage& usage) {
+  return fmt::format(
+      R"({{"samples":{},"sharedSamples":{},"patterns":{},"orders":{},)"
+      R"("metadata":{},"generatorState":{},"buffers":{},"caches":{},)"
+      R"("total":{}}})",
+      usage.samples, usage.sharedSamples, usage.patterns, usage.orders,
+      usage.metadata, usage.generatorState, usage.buffers, usage.caches,
+      usage.total());
+}
+
 std::string InfoString::intToNote(int i) {
   switch (i) {
     case 0:
@@ -2,6 +2,7 @@
 
 #include <string>
 
+#include "MemoryUsage.h"
 #include "Mod.h"
 #include "Note.h"
 #include "Pattern.h"
@@ -75,6 +76,14 @@ class InfoString {
 
   static std::string toString(const Mod &mod);
 
+  static std::string toString(const MemoryUsage &usage);
+
+  /**
+   * @param usage
+   * @return Single line JSON object with byte counts.
+   */
+  static std::string toJson(const MemoryUsage &usage);
+
   static std::string fancyRow(const Row &row);
 };
 
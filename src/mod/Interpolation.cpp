@@ -0,0 +1,30 @@
+#include "Interpolation.h"
+
+#include <stdexcept>
+
+namespace mod {
+
+std::string interpolationToString(Interpolation value) {
+  switch (value) {
+    case Interpolation::Nearest:
+      return "nearest";
+    case Interpolation::Linear:
+      return "linear";
+  }
+
+  return "unknown";
+}
+
+Interpolation interpolationFromString(const std::string &value) {
+  if (value == "nearest") {
+    return Interpolation::Nearest;
+  }
+
+  if (value == "linear") {
+    return Interpolation::Linear;
+  }
+
+  throw std::invalid_argument("Unknown interpolation: '" + value + "'");
+}
+
+}  // namespace mod
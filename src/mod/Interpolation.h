@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+namespace mod {
+
+enum class Interpolation {
+  Nearest = 0,
+  Linear,
+};
+
+std::string interpolationToString(Interpolation value);
+
+/**
+ * @param value "nearest" or "linear".
+ * @throws invalid_argument
+ */
+Interpolation interpolationFromString(const std::string &value);
+
+}  // namespace mod
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Pattern.h"
+#include "Sample.h"
+
+namespace mod {
+
+/**
+ * Decodes patterns and sample data of lazily loaded mod from its undecoded
+ * bytes. Called from any thread, each part at most once.
+ */
+class LazyDecoder {
+ public:
+  virtual ~LazyDecoder() = default;
+
+  /**
+   * @param index
+   * @throws runtime_error
+   */
+  [[nodiscard]] virtual Pattern decodePattern(size_t index) const = 0;
+
+  /**
+   * Sets data of sample. Other fields are already set when mod is created.
+   * @param index
+   * @param sample
+   * @throws runtime_error
+   */
+  virtual void decodeSample(size_t index, Sample &sample) const = 0;
+
+  /**
+   * @param index
+   * @return false if bytes of pattern were not received yet, so
+   * decodePattern would wait for them.
+   */
+  [[nodiscard]] virtual bool isPatternAvailable(
+      [[maybe_unused]] size_t index) const {
+    return true;
+  }
+
+  /**
+   * @param index
+   * @return false if bytes of sample were not received yet, so decodeSample
+   * would wait for them.
+   */
+  [[nodiscard]] virtual bool isSampleAvailable(
+      [[maybe_unused]] size_t index) const {
+    return true;
+  }
+};
+
+}  // namespace mod
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mod {
+
+/**
+ * Heap and object bytes, by category. Allocator overhead is not included.
+ */
+struct MemoryUsage {
+  // Sample audio data.
+  size_t samples = 0;
+  // Part of samples shared with other mods through SampleStore.
+  size_t sharedSamples = 0;
+  size_t patterns = 0;
+  size_t orders = 0;
+  // Names, sample headers and object sizes.
+  size_t metadata = 0;
+  // Channel states, muted channels and callbacks of generator.
+  size_t generatorState = 0;
+  // Mixing buffers of calling thread.
+  size_t buffers = 0;
+  size_t caches = 0;
+
+  [[nodiscard]] size_t total() const {
+    return samples + patterns + orders + metadata + generatorState + buffers +
+           caches;
+  }
+
+  MemoryUsage &operator+=(const MemoryUsage &other) {
+    samples += other.samples;
+    sharedSamples += other.sharedSamples;
+    patterns += other.patterns;
+    orders += other.orders;
+    metadata += other.metadata;
+    generatorState += other.generatorState;
+    buffers += other.buffers;
+    caches += other.caches;
+
+    return *this;
+  }
+};
+
+}  // namespace mod
@@ -1,9 +1,52 @@
 #include "Mod.h"
 
+#include <fmt/format.h>
+
+#include <stdexcept>
 #include <utility>
 
 namespace mod {
 
+#pragma region private
+
+void Mod::decodePattern(size_t index) const {
+  if (this->_lazy->patternsDecoded[index].load(std::memory_order_acquire)) {
+    return;
+  }
+
+  std::call_once(this->_lazy->patternFlags[index], [this, index]() {
+    this->_patterns[index] = this->_lazy->decoder->decodePattern(index);
+    this->_lazy->patternsDecoded[index].store(true, std::memory_order_release);
+  });
+}
+
+void Mod::decodeSample(size_t index) const {
+  if (this->_lazy->samplesDecoded[index].load(std::memory_order_acquire)) {
+    return;
+  }
+
+  std::call_once(this->_lazy->sampleFlags[index], [this, index]() {
+    this->_lazy->decoder->decodeSample(index, this->_samples[index]);
+    this->_lazy->samplesDecoded[index].store(true, std::memory_order_release);
+  });
+}
+
+void Mod::decodeAll() const {
+  if (this->_lazy == nullptr) {
+    return;
+  }
+
+  for (size_t i = 0; i < this->_patterns.size(); i++) {
+    this->decodePattern(i);
+  }
+
+  for (size_t i = 0; i < this->_samples.size(); i++) {
+    this->decodeSample(i);
+  }
+}
+
+#pragma endregion
+
 Mod::Mod(std::string name, size_t songLength,
          std::vector<Sample> samples, std::vector<Pattern> patterns,
          std::vector<int> orders)
@@ -17,6 +60,35 @@ Mod::Mod(std::string name, size_t songLength,
   }
 }
 
+Mod::Mod(std::string name, size_t songLength, size_t channels,
+         std::vector<Sample> samples, size_t patternCount,
+         std::vector<int> orders, std::shared_ptr<const LazyDecoder> decoder)
+    : _name(std::move(name)),
+      _songLength(songLength),
+      _channels(channels),
+      _samples(std::move(samples)),
+      _patterns(patternCount, Pattern(channels, 0)),
+      _orders(std::move(orders)),
+      _lazy(std::make_unique<LazyState>()) {
+  const size_t sampleCount = this->_samples.size();
+
+  this->_lazy->decoder = std::move(decoder);
+  this->_lazy->patternFlags = std::make_unique<std::once_flag[]>(patternCount);
+  this->_lazy->patternsDecoded =
+      std::make_unique<std::atomic<bool>[]>(patternCount);
+  this->_lazy->sampleFlags = std::make_unique<std::once_flag[]>(sampleCount);
+  this->_lazy->samplesDecoded =
+      std::make_unique<std::atomic<bool>[]>(sampleCount);
+
+  for (size_t i = 0; i < patternCount; i++) {
+    this->_lazy->patternsDecoded[i] = false;
+  }
+
+  for (size_t i = 0; i < sampleCount; i++) {
+    this->_lazy->samplesDecoded[i] = false;
+  }
+}
+
 size_t Mod::getChannels() const { return this->_channels; }
 
 size_t Mod::getSongLength() const { return this->_songLength; }
@@ -25,22 +97,234 @@ size_t Mod::getSampleCount() const { return this->_samples.size(); }
 
 size_t Mod::getPatternCount() const { return this->_patterns.size(); }
 
-std::vector<Sample>& Mod::getSamples() { return this->_samples; }
+std::vector<Sample>& Mod::getSamples() {
+  this->decodeAll();
+
+  return this->_samples;
+}
 
 std::vector<int>& Mod::getOrders() { return this->_orders; }
 
-std::vector<Pattern>& Mod::getPatterns() { return this->_patterns; }
+std::vector<Pattern>& Mod::getPatterns() {
+  this->decodeAll();
+
+  return this->_patterns;
+}
 
 const std::vector<Sample>& Mod::getSamples() const {
+  this->decodeAll();
+
   return this->_samples;
 }
 
 const std::vector<int>& Mod::getOrders() const { return this->_orders; }
 
 const std::vector<Pattern>& Mod::getPatterns() const {
+  this->decodeAll();
+
   return this->_patterns;
 }
 
 const std::string& Mod::getName() const { return this->_name; }
 
+const Pattern& Mod::getPattern(size_t index) const {
+  if (index >= this->_patterns.size()) {
+    throw std::out_of_range(
+        fmt::format("getPattern: Pattern index out of range: {}. Total "
+                    "patterns: {}",
+                    index, this->_patterns.size()));
+  }
+
+  if (this->_lazy != nullptr) {
+    this->decodePattern(index);
+  }
+
+  return this->_patterns[index];
+}
+
+const Sample& Mod::getSample(size_t index) const {
+  if (index >= this->_samples.size()) {
+    throw std::out_of_range(
+        fmt::format("getSample: Sample index out of range: {}. Total "
+                    "samples: {}",
+                    index, this->_samples.size()));
+  }
+
+  if (this->_lazy != nullptr) {
+    this->decodeSample(index);
+  }
+
+  return this->_samples[index];
+}
+
+bool Mod::prefetch(size_t orderIndex) const {
+  if (orderIndex >= this->_orders.size()) {
+    throw std::out_of_range(
+        fmt::format("prefetch: Order index out of range: {}. Total orders: {}",
+                    orderIndex, this->_orders.size()));
+  }
+
+  if (this->_lazy == nullptr) {
+    return true;
+  }
+
+  const size_t patternIndex = this->_orders[orderIndex];
+
+  if (!this->_lazy->patternsDecoded[patternIndex].load(
+          std::memory_order_acquire) &&
+      !this->_lazy->decoder->isPatternAvailable(patternIndex)) {
+    return false;
+  }
+
+  for (const auto& row : this->getPattern(patternIndex).getRows()) {
+    for (const auto& note : row.getNotes()) {
+      if (note.sampleIndex <= 0 ||
+          (size_t)note.sampleIndex > this->_samples.size()) {
+        continue;
+      }
+
+      const size_t sampleIndex = note.sampleIndex - 1;
+
+      if (!this->_lazy->samplesDecoded[sampleIndex].load(
+              std::memory_order_acquire) &&
+          !this->_lazy->decoder->isSampleAvailable(sampleIndex)) {
+        return false;
+      }
+
+      this->decodeSample(sampleIndex);
+    }
+  }
+
+  return true;
+}
+
+bool Mod::isOrderAvailable(size_t orderIndex) const {
+  if (orderIndex >= this->_orders.size()) {
+    throw std::out_of_range(fmt::format(
+        "isOrderAvailable: Order index out of range: {}. Total orders: {}",
+        orderIndex, this->_orders.size()));
+  }
+
+  if (this->_lazy == nullptr) {
+    return true;
+  }
+
+  const size_t patternIndex = this->_orders[orderIndex];
+
+  // Decoding pattern to find its samples is left to prefetch.
+  if (!this->_lazy->patternsDecoded[patternIndex].load(
+          std::memory_order_acquire)) {
+    return false;
+  }
+
+  for (const auto& row : this->_patterns[patternIndex].getRows()) {
+    for (const auto& note : row.getNotes()) {
+      if (note.sampleIndex <= 0 ||
+          (size_t)note.sampleIndex > this->_samples.size()) {
+        continue;
+      }
+
+      const size_t sampleIndex = note.sampleIndex - 1;
+
+      if (!this->_lazy->samplesDecoded[sampleIndex].load(
+              std::memory_order_acquire) &&
+          !this->_lazy->decoder->isSampleAvailable(sampleIndex)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool Mod::isOrderDecoded(size_t orderIndex) const {
+  if (orderIndex >= this->_orders.size()) {
+    throw std::out_of_range(fmt::format(
+        "isOrderDecoded: Order index out of range: {}. Total orders: {}",
+        orderIndex, this->_orders.size()));
+  }
+
+  if (this->_lazy == nullptr) {
+    return true;
+  }
+
+  const size_t patternIndex = this->_orders[orderIndex];
+
+  if (!this->_lazy->patternsDecoded[patternIndex].load(
+          std::memory_order_acquire)) {
+    return false;
+  }
+
+  for (const auto& row : this->_patterns[patternIndex].getRows()) {
+    for (const auto& note : row.getNotes()) {
+      if (note.sampleIndex > 0 &&
+          (size_t)note.sampleIndex <= this->_samples.size() &&
+          !this->_lazy->samplesDecoded[note.sampleIndex - 1].load(
+              std::memory_order_acquire)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool Mod::isLazy() const { return this->_lazy != nullptr; }
+
+MemoryUsage Mod::memoryUsage() const {
+  MemoryUsage usage;
+
+  usage.metadata += sizeof(Mod) + this->_name.capacity();
+  usage.metadata += this->_samples.capacity() * sizeof(Sample);
+
+  if (this->_lazy != nullptr) {
+    const size_t parts = this->_patterns.size() + this->_samples.size();
+
+    usage.metadata += sizeof(LazyState);
+    usage.metadata += parts * (sizeof(std::once_flag) + sizeof(bool));
+  }
+
+  for (size_t i = 0; i < this->_samples.size(); i++) {
+    const Sample& sample = this->_samples[i];
+
+    usage.metadata += sample.getName().capacity();
+
+    if (sample.getLength() == 0 ||
+        (this->_lazy != nullptr &&
+         !this->_lazy->samplesDecoded[i].load(std::memory_order_acquire))) {
+      continue;
+    }
+
+    const SampleData& data = sample.getData();
+    const size_t dataBytes = data.size() * sizeof(float);
+
+    usage.samples += dataBytes;
+
+    if (data.useCount() > 1) {
+      usage.sharedSamples += dataBytes;
+    }
+  }
+
+  usage.patterns += this->_patterns.capacity() * sizeof(Pattern);
+
+  for (size_t i = 0; i < this->_patterns.size(); i++) {
+    if (this->_lazy != nullptr &&
+        !this->_lazy->patternsDecoded[i].load(std::memory_order_acquire)) {
+      continue;
+    }
+
+    const Pattern& pattern = this->_patterns[i];
+
+    usage.patterns += pattern.getRows().capacity() * sizeof(Row);
+
+    for (const auto& row : pattern.getRows()) {
+      usage.patterns += row.getNotes().capacity() * sizeof(Note);
+    }
+  }
+
+  usage.orders += this->_orders.capacity() * sizeof(int);
+
+  return usage;
+}
+
 }  // namespace mod
\ No newline at end of file
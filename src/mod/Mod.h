@@ -1,29 +1,72 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
 #include "Encoding.h"
+#include "LazyDecoder.h"
+#include "MemoryUsage.h"
 #include "Pattern.h"
 #include "Sample.h"
 
 namespace mod {
 
+/**
+ * Const member functions do not modify mod, so std::shared_ptr<const Mod> can
+ * be read by many generators on different threads.
+ *
+ * Lazily loaded mod decodes a pattern or sample data on first access through
+ * getPattern, getSample or prefetch. Getters of whole vectors decode
+ * everything first.
+ */
 class Mod {
  private:
+  struct LazyState {
+    std::shared_ptr<const LazyDecoder> decoder;
+    std::unique_ptr<std::once_flag[]> patternFlags;
+    std::unique_ptr<std::atomic<bool>[]> patternsDecoded;
+    std::unique_ptr<std::once_flag[]> sampleFlags;
+    std::unique_ptr<std::atomic<bool>[]> samplesDecoded;
+  };
+
   std::string _name;
   size_t _songLength = 0;
   size_t _channels = 0;
 
-  std::vector<Sample> _samples;
-  std::vector<Pattern> _patterns;
+  // Elements of lazily loaded mod are written once, under their flag.
+  mutable std::vector<Sample> _samples;
+  mutable std::vector<Pattern> _patterns;
   std::vector<int> _orders;
+  std::unique_ptr<LazyState> _lazy = nullptr;
+
+  void decodePattern(size_t index) const;
+
+  void decodeSample(size_t index) const;
+
+  void decodeAll() const;
 
  public:
   Mod(std::string name, size_t songLength,
       std::vector<Sample> samples, std::vector<Pattern> patterns,
       std::vector<int> orders);
 
+  /**
+   * Creates lazily loaded mod.
+   * @param name
+   * @param songLength
+   * @param channels
+   * @param samples Samples without data.
+   * @param patternCount
+   * @param orders
+   * @param decoder
+   */
+  Mod(std::string name, size_t songLength, size_t channels,
+      std::vector<Sample> samples, size_t patternCount,
+      std::vector<int> orders, std::shared_ptr<const LazyDecoder> decoder);
+
   Mod() = default;
 
   [[nodiscard]] size_t getChannels() const;
@@ -47,6 +90,58 @@ class Mod {
   [[nodiscard]] const std::vector<Pattern> &getPatterns() const;
 
   [[nodiscard]] const std::string &getName() const;
+
+  /**
+   * @param index
+   * @throws out_of_range
+   */
+  [[nodiscard]] const Pattern &getPattern(size_t index) const;
+
+  /**
+   * @param index
+   * @throws out_of_range
+   */
+  [[nodiscard]] const Sample &getSample(size_t index) const;
+
+  /**
+   * Decodes pattern played at order and samples its notes trigger, so
+   * getPattern and getSample for them do not decode. Does not wait for data
+   * of streamed mod, parts received before missing one are decoded.
+   * @param orderIndex
+   * @return false if pattern or a sample its notes trigger is not received
+   * yet.
+   * @throws out_of_range
+   */
+  bool prefetch(size_t orderIndex) const;
+
+  /**
+   * Does not decode and does not wait for data of streamed mod. Samples of
+   * pattern are only known once it is decoded, so order whose pattern is
+   * not decoded yet is not available, see prefetch.
+   * @param orderIndex
+   * @return false if pattern played at order is not decoded yet, or a
+   * sample its notes trigger is not received yet.
+   * @throws out_of_range
+   */
+  [[nodiscard]] bool isOrderAvailable(size_t orderIndex) const;
+
+  /**
+   * Does not decode.
+   * @param orderIndex
+   * @return true if pattern played at order and samples its notes trigger
+   * are decoded, so getPattern and getSample for them do not decode.
+   * @throws out_of_range
+   */
+  [[nodiscard]] bool isOrderDecoded(size_t orderIndex) const;
+
+  [[nodiscard]] bool isLazy() const;
+
+  /**
+   * Parts of lazily loaded mod which were not decoded yet are not counted.
+   * @return Memory held by mod. Shared sample data is counted in full and
+   * also reported in sharedSamples.
+   */
+  [[nodiscard]] MemoryUsage memoryUsage() const;
 };
 
 }  // namespace mod
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace mod {
+
+/**
+ * Mod metadata read from header only, without patterns and sample data.
+ */
+struct ModInfo {
+  std::string name;
+  std::vector<std::string> sampleNames;
+  size_t channels = 0;
+  size_t songLength = 0;
+  size_t patternCount = 0;
+  // In seconds, assuming default speed 6 and 125 BPM for whole song, as
+  // speed changes are stored in patterns.
+  float estimatedDuration = 0.0f;
+};
+
+}  // namespace mod
@@ -1,5 +1,6 @@
 #include "Pattern.h"
 #include <string>
+#include <utility>
 
 namespace mod {
 
@@ -8,7 +9,9 @@ Pattern::Pattern(size_t channels, size_t totalRows)
   _rows.reserve(this->_totalRows);
 }
 
-void Pattern::addRow(const Row& newRow) {
+void Pattern::addRow(const Row& newRow) { this->addRow(Row(newRow)); }
+
+void Pattern::addRow(Row&& newRow) {
   if (newRow.getChannels() != this->_channels) {
     const std::string message =
         "newRow has " + std::to_string(newRow.getChannels()) +
@@ -25,7 +28,7 @@ void Pattern::addRow(const Row& newRow) {
     throw std::out_of_range(message);
   }
 
-  this->_rows.push_back(newRow);
+  this->_rows.push_back(std::move(newRow));
 }
 
 const Row& Pattern::getRow(size_t index) const {
@@ -23,6 +23,13 @@ class Pattern {
    */
   void addRow(const Row &newRow);
 
+  /**
+   * @param newRow
+   * @throw std::invalid_argument
+   * @throw std::out_of_range
+   */
+  void addRow(Row &&newRow);
+
   /**
    *
    * @param index
@@ -0,0 +1,235 @@
+#include "Realtime.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "ScratchPool.h"
+
+#ifdef __linux__
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace mod::realtime {
+
+#pragma region private
+
+namespace {
+
+using Region = std::pair<uintptr_t, uintptr_t>;
+
+size_t pageSize() {
+#ifdef __linux__
+  static const auto size = (size_t)sysconf(_SC_PAGESIZE);
+
+  return size;
+#else
+  return 4096;
+#endif
+}
+
+void addRegion(std::vector<Region> &regions, const void *data, size_t size) {
+  if (data == nullptr || size == 0) {
+    return;
+  }
+
+  const uintptr_t mask = ~(uintptr_t)(pageSize() - 1);
+  const auto begin = (uintptr_t)data & mask;
+  const auto end = ((uintptr_t)data + size + pageSize() - 1) & mask;
+
+  regions.emplace_back(begin, end);
+}
+
+/**
+ * Sorts regions and joins overlapping or adjacent ones, so row sized
+ * allocations sharing a page are locked with single call.
+ */
+std::vector<Region> mergeRegions(std::vector<Region> regions) {
+  std::sort(regions.begin(), regions.end());
+
+  std::vector<Region> merged;
+
+  for (const auto &region : regions) {
+    if (!merged.empty() && region.first <= merged.back().second) {
+      merged.back().second = std::max(merged.back().second, region.second);
+    } else {
+      merged.push_back(region);
+    }
+  }
+
+  return merged;
+}
+
+void prefault(uintptr_t begin, uintptr_t end) {
+  for (uintptr_t page = begin; page < end; page += pageSize()) {
+    (void)*(const volatile char *)page;
+  }
+}
+
+bool lockRegions(const std::vector<Region> &regions) {
+  bool locked = true;
+
+  for (const auto &[begin, end] : mergeRegions(regions)) {
+    prefault(begin, end);
+#ifdef __linux__
+    if (mlock((const void *)begin, end - begin) != 0) {
+      locked = false;
+    }
+#else
+    locked = false;
+#endif
+  }
+
+  return locked;
+}
+
+void unlockRegions(const std::vector<Region> &regions) {
+#ifdef __linux__
+  for (const auto &[begin, end] : mergeRegions(regions)) {
+    munlock((const void *)begin, end - begin);
+  }
+#endif
+}
+
+std::vector<Region> modRegions(const Mod &mod) {
+  std::vector<Region> regions;
+
+  for (const auto &sample : mod.getSamples()) {
+    if (sample.getLength() == 0) {
+      continue;
+    }
+
+    const SampleData &data = sample.getData();
+
+    addRegion(regions, data.data(), data.size() * sizeof(float));
+  }
+
+  const std::vector<Pattern> &patterns = mod.getPatterns();
+
+  addRegion(regions, patterns.data(), patterns.size() * sizeof(Pattern));
+
+  for (const auto &pattern : patterns) {
+    const std::vector<Row> &rows = pattern.getRows();
+
+    addRegion(regions, rows.data(), rows.size() * sizeof(Row));
+
+    for (const auto &row : rows) {
+      const std::vector<Note> &notes = row.getNotes();
+
+      addRegion(regions, notes.data(), notes.size() * sizeof(Note));
+    }
+  }
+
+  const std::vector<int> &orders = mod.getOrders();
+
+  addRegion(regions, orders.data(), orders.size() * sizeof(int));
+
+  return regions;
+}
+
+}  // namespace
+
+#pragma endregion
+
+bool lockMemory(const void *data, size_t size) {
+  std::vector<Region> regions;
+
+  addRegion(regions, data, size);
+
+  return lockRegions(regions);
+}
+
+void unlockMemory(const void *data, size_t size) {
+  std::vector<Region> regions;
+
+  addRegion(regions, data, size);
+
+  unlockRegions(regions);
+}
+
+bool lockMod(const Mod &mod) { return lockRegions(modRegions(mod)); }
+
+void unlockMod(const Mod &mod) { unlockRegions(modRegions(mod)); }
+
+bool lockGenerator(const Generator &generator) {
+  std::vector<Region> regions;
+
+  addRegion(regions, &generator, sizeof(Generator));
+  addRegion(regions, ScratchPool::peek().data(),
+            ScratchPool::peek().capacity() * sizeof(float));
+  addRegion(regions, generator._channelsStates.data(),
+            generator._channelsStates.size() *
+                sizeof(Generator::ChannelState));
+
+  return lockRegions(regions);
+}
+
+void unlockGenerator(const Generator &generator) {
+  std::vector<Region> regions;
+
+  addRegion(regions, &generator, sizeof(Generator));
+  addRegion(regions, ScratchPool::peek().data(),
+            ScratchPool::peek().capacity() * sizeof(float));
+  addRegion(regions, generator._channelsStates.data(),
+            generator._channelsStates.size() *
+                sizeof(Generator::ChannelState));
+
+  unlockRegions(regions);
+}
+
+void prefaultStack(size_t size) {
+#ifdef __linux__
+  auto *stack = (volatile char *)alloca(size);
+
+  for (size_t i = 0; i < size; i += pageSize()) {
+    stack[i] = 0;
+  }
+#endif
+}
+
+bool promoteCurrentThread(const RealtimeOptions &options) {
+#ifdef __linux__
+  const int policy =
+      options.policy == SchedulingPolicy::RoundRobin ? SCHED_RR : SCHED_FIFO;
+
+  int priority = std::clamp(options.priority, sched_get_priority_min(policy),
+                            sched_get_priority_max(policy));
+
+  rlimit limit{};
+
+  if (getrlimit(RLIMIT_RTPRIO, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+      limit.rlim_cur > 0) {
+    priority = std::min(priority, (int)limit.rlim_cur);
+  }
+
+  sched_param param{};
+  param.sched_priority = priority;
+
+  return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+#else
+  return false;
+#endif
+}
+
+SchedulingPolicy policyFromString(const std::string &name) {
+  if (name == "fifo") {
+    return SchedulingPolicy::Fifo;
+  }
+
+  if (name == "rr") {
+    return SchedulingPolicy::RoundRobin;
+  }
+
+  throw std::invalid_argument(
+      fmt::format("Unknown scheduling policy: '{}'", name));
+}
+
+}  // namespace mod::realtime
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "Generator.h"
+#include "Mod.h"
+
+namespace mod::realtime {
+
+enum class SchedulingPolicy {
+  Fifo = 0,
+  RoundRobin,
+};
+
+struct RealtimeOptions {
+  SchedulingPolicy policy = SchedulingPolicy::Fifo;
+  int priority = 70;
+  size_t stackPrefaultSize = 64 * 1024;
+};
+
+/**
+ * Touches every page in range so it is resident, then locks it in RAM.
+ * @param data
+ * @param size
+ * @return false if pages could not be locked. Pages are prefaulted anyway.
+ */
+bool lockMemory(const void *data, size_t size);
+
+void unlockMemory(const void *data, size_t size);
+
+/**
+ * Prefaults and locks sample data, patterns and orders of mod.
+ * @param mod
+ * @return false if any region could not be locked.
+ */
+bool lockMod(const Mod &mod);
+
+void unlockMod(const Mod &mod);
+
+/**
+ * Prefaults and locks generator state and mixing buffer of calling thread.
+ * Call from rendering thread after Generator::reserveBuffer.
+ * @param generator
+ * @return false if any region could not be locked.
+ */
+bool lockGenerator(const Generator &generator);
+
+void unlockGenerator(const Generator &generator);
+
+/**
+ * Touches stack pages of calling thread, so first deep call in audio
+ * callback does not page fault.
+ * @param size
+ */
+void prefaultStack(size_t size);
+
+/**
+ * Switches calling thread to realtime scheduling. Priority is clamped to
+ * policy range and to RLIMIT_RTPRIO when it is set.
+ * @param options
+ * @return false if scheduler refused; thread keeps its old policy.
+ */
+bool promoteCurrentThread(const RealtimeOptions &options);
+
+/**
+ * @param name "fifo" or "rr".
+ * @throws invalid_argument
+ */
+SchedulingPolicy policyFromString(const std::string &name);
+
+}  // namespace mod::realtime
@@ -4,6 +4,7 @@
 
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 namespace mod {
 
@@ -12,6 +13,9 @@ Row::Row(std::initializer_list<Note> notes)
 
 Row::Row(size_t channels) : _channels(channels) { _notes.reserve(_channels); }
 
+Row::Row(std::vector<Note> notes)
+    : _notes(std::move(notes)), _channels(_notes.size()) {}
+
 void Row::addNote(const Note& note) {
   if (this->_notes.size() >= this->_channels) {
     const std::string message = "Tried to add excess note. Channels: " +
@@ -37,5 +41,17 @@ const Note& Row::getNote(size_t index) const {
   return this->_notes[index];
 }
 
+Note& Row::getNote(size_t index) {
+  if (index >= this->_channels) {
+    const std::string message =
+        fmt::format("Tried access not existing channel {}. Total channels: {}",
+                    index, this->_channels);
+
+    throw std::out_of_range(message);
+  }
+
+  return this->_notes[index];
+}
+
 size_t Row::getChannels() const { return this->_channels; }
 }  // namespace mod
\ No newline at end of file
@@ -17,6 +17,12 @@ class Row {
 
   explicit Row(size_t channels);
 
+  /**
+   * Row with one note per channel.
+   * @param notes
+   */
+  explicit Row(std::vector<Note> notes);
+
   /**
    * @param note
    * @throw std::out_of_range
@@ -32,6 +38,13 @@ class Row {
    */
   [[nodiscard]] const Note &getNote(size_t index) const;
 
+  /**
+   * @param index
+   * @throw std::out_of_range
+   * @return
+   */
+  Note &getNote(size_t index);
+
   [[nodiscard]] size_t getChannels() const;
 };
 
@@ -33,25 +33,19 @@ int Sample::getRepeatPoint() const { return this->_repeatPoint; }
 
 int Sample::getRepeatLength() const { return this->_repeatLength; }
 
-void Sample::reserveData() { this->_data.resize(this->_length); }
-
-std::vector<float>& Sample::getData() {
+const SampleData& Sample::getData() const {
   if (this->_data.size() != this->_length) {
-    throw std::runtime_error("Sample data was not set or reserved.");
+    throw std::runtime_error("Sample data was not set.");
   }
 
   return this->_data;
 }
 
-const std::vector<float>& Sample::getData() const {
-  if (this->_data.size() != this->_length) {
-    throw std::runtime_error("Sample data was not set or reserved.");
-  }
-
-  return this->_data;
+void Sample::setData(std::vector<float> data) {
+  this->setData(SampleData(std::move(data)));
 }
 
-void Sample::setData(const std::vector<float>& data) {
+void Sample::setData(SampleData data) {
   if (data.size() != this->_length) {
     const std::string message = fmt::format(
         "Cannot set sample data: unexpected new data length. "
@@ -61,7 +55,7 @@ void Sample::setData(const std::vector<float>& data) {
     throw std::runtime_error(message);
   }
 
-  this->_data = data;
+  this->_data = std::move(data);
 }
 
 }  // namespace mod
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "Encoding.h"
+#include "SampleData.h"
 
 namespace mod {
 
@@ -17,7 +18,7 @@ class Sample {
   int _repeatPoint;
   int _repeatLength;
   float _dataFrequency;
-  std::vector<float> _data;
+  SampleData _data;
 
  public:
   /**
@@ -39,23 +40,22 @@ class Sample {
   [[nodiscard]] int getVolume() const;
   [[nodiscard]] int getRepeatPoint() const;
   [[nodiscard]] int getRepeatLength() const;
-  void reserveData();
   /**
    * @throw std::runtime_error
    * @return
    */
-  [[nodiscard]] std::vector<float> &getData();
-
+  [[nodiscard]] const SampleData &getData() const;
   /**
+   * @param data
    * @throw std::runtime_error
-   * @return
    */
-  [[nodiscard]] const std::vector<float> &getData() const;
+  void setData(std::vector<float> data);
   /**
+   * Shares data with other samples instead of copying it.
    * @param data
    * @throw std::runtime_error
    */
-  void setData(const std::vector<float> &data);
+  void setData(SampleData data);
 
   float getDataFrequency() const {
     return this->_dataFrequency;
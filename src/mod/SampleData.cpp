@@ -0,0 +1,18 @@
+#include "SampleData.h"
+
+#include <utility>
+
+namespace mod {
+
+SampleData::SampleData(std::shared_ptr<const float> data, size_t size)
+    : _data(std::move(data)), _size(size) {}
+
+SampleData::SampleData(std::vector<float> data) : _size(data.size()) {
+  auto storage = std::make_shared<const std::vector<float>>(std::move(data));
+
+  this->_data = std::shared_ptr<const float>(storage, storage->data());
+}
+
+long SampleData::useCount() const { return this->_data.use_count(); }
+
+}  // namespace mod
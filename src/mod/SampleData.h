@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace mod {
+
+/**
+ * Read only view over sample audio data. Keeps the storage it points to
+ * alive, so same data can be shared between samples of different mods.
+ */
+class SampleData {
+ private:
+  std::shared_ptr<const float> _data = nullptr;
+  size_t _size = 0;
+
+ public:
+  SampleData() = default;
+
+  /**
+   * @param data Pointer to first value, owning the storage.
+   * @param size
+   */
+  SampleData(std::shared_ptr<const float> data, size_t size);
+
+  /**
+   * Takes ownership of data.
+   * @param data
+   */
+  explicit SampleData(std::vector<float> data);
+
+  [[nodiscard]] size_t size() const { return this->_size; }
+
+  [[nodiscard]] bool empty() const { return this->_size == 0; }
+
+  [[nodiscard]] const float *data() const { return this->_data.get(); }
+
+  [[nodiscard]] const float *begin() const { return this->_data.get(); }
+
+  [[nodiscard]] const float *end() const {
+    return this->_data.get() + this->_size;
+  }
+
+  const float &operator[](size_t index) const { return this->_data.get()[index]; }
+
+  /**
+   * @return Number of SampleData instances sharing this storage.
+   */
+  [[nodiscard]] long useCount() const;
+};
+
+}  // namespace mod
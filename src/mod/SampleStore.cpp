@@ -0,0 +1,133 @@
+#include "SampleStore.h"
+
+#include <cstring>
+#include <utility>
+
+namespace mod {
+
+constexpr size_t purgeInterval = 256;
+
+#pragma region private
+
+uint64_t SampleStore::hash(const std::vector<float> &data) {
+  // FNV-1a over 32 bit words.
+  uint64_t result = 14695981039346656037ULL;
+
+  for (const float &value : data) {
+    uint32_t word;
+
+    std::memcpy(&word, &value, sizeof(word));
+
+    result ^= word;
+    result *= 1099511628211ULL;
+  }
+
+  return result ^ data.size();
+}
+
+void SampleStore::purgeLocked() {
+  for (auto it = this->_entries.begin(); it != this->_entries.end();) {
+    if (it->second.expired()) {
+      it = this->_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+#pragma endregion
+
+std::shared_ptr<SampleStore> SampleStore::global() {
+  static std::shared_ptr<SampleStore> store = std::make_shared<SampleStore>();
+
+  return store;
+}
+
+SampleData SampleStore::intern(std::vector<float> data) {
+  const uint64_t key = SampleStore::hash(data);
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  auto [begin, end] = this->_entries.equal_range(key);
+
+  for (auto it = begin; it != end;) {
+    std::shared_ptr<const std::vector<float>> stored = it->second.lock();
+
+    if (stored == nullptr) {
+      it = this->_entries.erase(it);
+      continue;
+    }
+
+    if (stored->size() == data.size() &&
+        std::memcmp(stored->data(), data.data(),
+                    data.size() * sizeof(float)) == 0) {
+      this->_hits++;
+
+      return {std::shared_ptr<const float>(stored, stored->data()),
+              stored->size()};
+    }
+
+    ++it;
+  }
+
+  this->_misses++;
+
+  if (this->_misses % purgeInterval == 0) {
+    this->purgeLocked();
+  }
+
+  auto stored = std::make_shared<const std::vector<float>>(std::move(data));
+
+  this->_entries.emplace(key, stored);
+
+  return {std::shared_ptr<const float>(stored, stored->data()),
+          stored->size()};
+}
+
+void SampleStore::purge() {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  this->purgeLocked();
+}
+
+size_t SampleStore::getEntryCount() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  size_t count = 0;
+
+  for (const auto &[key, entry] : this->_entries) {
+    if (!entry.expired()) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+size_t SampleStore::getStoredBytes() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  size_t bytes = 0;
+
+  for (const auto &[key, entry] : this->_entries) {
+    if (auto stored = entry.lock()) {
+      bytes += stored->size() * sizeof(float);
+    }
+  }
+
+  return bytes;
+}
+
+size_t SampleStore::getHits() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  return this->_hits;
+}
+
+size_t SampleStore::getMisses() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  return this->_misses;
+}
+
+}  // namespace mod
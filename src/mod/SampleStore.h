@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "SampleData.h"
+
+namespace mod {
+
+/**
+ * Content addressed storage for sample data. Identical data interned by
+ * different mods is stored once and released when last sample using it is
+ * destroyed. Thread safe.
+ */
+class SampleStore {
+ private:
+  std::unordered_multimap<uint64_t, std::weak_ptr<const std::vector<float>>>
+      _entries;
+  mutable std::mutex _mutex;
+  size_t _hits = 0;
+  size_t _misses = 0;
+
+  static uint64_t hash(const std::vector<float> &data);
+
+  /**
+   * Removes entries whose data was released. Expects locked mutex.
+   */
+  void purgeLocked();
+
+ public:
+  SampleStore() = default;
+
+  SampleStore(const SampleStore &) = delete;
+  SampleStore &operator=(const SampleStore &) = delete;
+
+  /**
+   * @return Process wide store.
+   */
+  static std::shared_ptr<SampleStore> global();
+
+  /**
+   * @param data
+   * @return Stored data equal to passed one, or passed data if it was not
+   * stored yet.
+   */
+  SampleData intern(std::vector<float> data);
+
+  /**
+   * Removes entries whose data was released.
+   */
+  void purge();
+
+  /**
+   * @return Number of alive distinct data blocks.
+   */
+  [[nodiscard]] size_t getEntryCount() const;
+
+  /**
+   * @return Bytes held by alive distinct data blocks.
+   */
+  [[nodiscard]] size_t getStoredBytes() const;
+
+  [[nodiscard]] size_t getHits() const;
+
+  [[nodiscard]] size_t getMisses() const;
+};
+
+}  // namespace mod
@@ -0,0 +1,40 @@
+#include "ScratchPool.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace mod {
+
+namespace {
+
+std::vector<float> &slotBuffer(size_t slot) {
+  // Deque keeps references to existing slots valid when growing.
+  thread_local std::deque<std::vector<float>> buffers;
+
+  if (slot >= buffers.size()) {
+    buffers.resize(slot + 1);
+  }
+
+  return buffers[slot];
+}
+
+}  // namespace
+
+std::vector<float> &ScratchPool::acquire(size_t size, size_t slot) {
+  std::vector<float> &buffer = slotBuffer(slot);
+
+  buffer.resize(size);
+  std::fill(buffer.begin(), buffer.end(), 0.0f);
+
+  return buffer;
+}
+
+void ScratchPool::reserve(size_t size, size_t slot) {
+  slotBuffer(slot).reserve(size);
+}
+
+const std::vector<float> &ScratchPool::peek(size_t slot) {
+  return slotBuffer(slot);
+}
+
+}  // namespace mod
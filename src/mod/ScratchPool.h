@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace mod {
+
+/**
+ * Mixing buffers owned by calling thread. Generators running on same thread
+ * borrow the same buffers instead of keeping their own.
+ */
+class ScratchPool {
+ public:
+  ScratchPool() = delete;
+
+  /**
+   * @param size Number of floats.
+   * @param slot Independent buffers for callers needing more than one.
+   * @return Zeroed buffer of exactly size floats. Valid until next call with
+   * same slot on this thread.
+   */
+  static std::vector<float> &acquire(size_t size, size_t slot = 0);
+
+  /**
+   * Grows buffer of calling thread, so acquire of up to size does not
+   * allocate.
+   * @param size Number of floats.
+   * @param slot
+   */
+  static void reserve(size_t size, size_t slot = 0);
+
+  /**
+   * @param slot
+   * @return Buffer of calling thread, for locking in memory.
+   */
+  static const std::vector<float> &peek(size_t slot = 0);
+};
+
+}  // namespace mod
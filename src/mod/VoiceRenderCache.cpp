@@ -0,0 +1,155 @@
+#include "VoiceRenderCache.h"
+
+#include <cmath>
+#include <functional>
+#include <utility>
+
+namespace mod {
+
+#pragma region private
+
+bool VoiceRenderCache::Key::operator==(const Key &other) const {
+  return sampleData == other.sampleData &&
+         sampleLength == other.sampleLength && period == other.period &&
+         finetune == other.finetune &&
+         outputFrequency == other.outputFrequency &&
+         interpolation == other.interpolation;
+}
+
+size_t VoiceRenderCache::KeyHash::operator()(const Key &key) const {
+  size_t result = std::hash<const float *>()(key.sampleData);
+
+  const auto combine = [&result](size_t value) {
+    result ^= value + 0x9e3779b97f4a7c15ULL + (result << 6) + (result >> 2);
+  };
+
+  combine(key.sampleLength);
+  combine(std::hash<int>()(key.period));
+  combine(std::hash<int>()(key.finetune));
+  combine(std::hash<float>()(key.outputFrequency));
+  combine((size_t)key.interpolation);
+
+  return result;
+}
+
+void VoiceRenderCache::evictLocked(size_t needed) {
+  while (!this->_recentlyUsed.empty() &&
+         this->_size + needed > this->_capacity) {
+    auto it = this->_entries.find(this->_recentlyUsed.back());
+
+    this->_size -= it->second.render->size() * sizeof(float);
+    this->_entries.erase(it);
+    this->_recentlyUsed.pop_back();
+  }
+}
+
+#pragma endregion
+
+VoiceRenderCache::VoiceRenderCache(size_t capacity) : _capacity(capacity) {}
+
+std::vector<float> VoiceRenderCache::render(const SampleData &data,
+                                            float pitch,
+                                            Interpolation interpolation) {
+  std::vector<float> result;
+
+  if (data.empty() || pitch <= 0.0f) {
+    return result;
+  }
+
+  result.reserve((size_t)std::ceil((float)data.size() / pitch));
+
+  for (size_t frame = 0;; frame++) {
+    const float position = (float)frame * pitch;
+    const auto index = (size_t)position;
+
+    if (index >= data.size()) {
+      break;
+    }
+
+    if (interpolation == Interpolation::Linear && index + 1 < data.size()) {
+      const float fraction = position - (float)index;
+
+      result.push_back(data[index] +
+                       (data[index + 1] - data[index]) * fraction);
+    } else {
+      result.push_back(data[index]);
+    }
+  }
+
+  return result;
+}
+
+VoiceRenderCache::Render VoiceRenderCache::get(const Key &key,
+                                               const SampleData &data,
+                                               float pitch) {
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+
+    auto it = this->_entries.find(key);
+
+    if (it != this->_entries.end()) {
+      this->_hits++;
+      this->_recentlyUsed.splice(this->_recentlyUsed.begin(),
+                                 this->_recentlyUsed, it->second.position);
+
+      return it->second.render;
+    }
+
+    this->_misses++;
+  }
+
+  // Render without lock, so other generators are not blocked by it.
+  auto rendered = std::make_shared<const std::vector<float>>(
+      VoiceRenderCache::render(data, pitch, key.interpolation));
+  const size_t bytes = rendered->size() * sizeof(float);
+
+  if (bytes > this->_capacity) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  auto it = this->_entries.find(key);
+
+  if (it != this->_entries.end()) {
+    return it->second.render;
+  }
+
+  this->evictLocked(bytes);
+
+  this->_recentlyUsed.push_front(key);
+  this->_entries.emplace(key, Entry{data, rendered, this->_recentlyUsed.begin()});
+  this->_size += bytes;
+
+  return rendered;
+}
+
+void VoiceRenderCache::clear() {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  this->_entries.clear();
+  this->_recentlyUsed.clear();
+  this->_size = 0;
+}
+
+size_t VoiceRenderCache::getCapacity() const { return this->_capacity; }
+
+size_t VoiceRenderCache::getSize() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  return this->_size;
+}
+
+size_t VoiceRenderCache::getHits() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  return this->_hits;
+}
+
+size_t VoiceRenderCache::getMisses() const {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+
+  return this->_misses;
+}
+
+}  // namespace mod
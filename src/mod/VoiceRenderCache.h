@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Interpolation.h"
+#include "SampleData.h"
+
+namespace mod {
+
+/**
+ * Bounded LRU cache of one-shot sample renders at unit volume. A trigger of
+ * non looping sample at already seen pitch becomes a scaled add from cached
+ * render instead of resampling. Thread safe, so it can be shared between
+ * generators.
+ */
+class VoiceRenderCache {
+ public:
+  struct Key {
+    const float *sampleData;
+    size_t sampleLength;
+    int period;
+    int finetune;
+    float outputFrequency;
+    Interpolation interpolation;
+
+    bool operator==(const Key &other) const;
+  };
+
+  using Render = std::shared_ptr<const std::vector<float>>;
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  struct Entry {
+    // Keeps sample data alive, so its address is not reused by other data
+    // while key refers to it.
+    SampleData source;
+    Render render;
+    std::list<Key>::iterator position;
+  };
+
+  std::list<Key> _recentlyUsed;
+  std::unordered_map<Key, Entry, KeyHash> _entries;
+  mutable std::mutex _mutex;
+  size_t _capacity;
+  size_t _size = 0;
+  size_t _hits = 0;
+  size_t _misses = 0;
+
+  void evictLocked(size_t needed);
+
+ public:
+  /**
+   * @param capacity Maximum bytes of cached renders.
+   */
+  explicit VoiceRenderCache(size_t capacity);
+
+  VoiceRenderCache(const VoiceRenderCache &) = delete;
+  VoiceRenderCache &operator=(const VoiceRenderCache &) = delete;
+
+  /**
+   * Resamples data the same way generator does for one-shot trigger.
+   * @param data
+   * @param pitch Sample frames advanced per output frame.
+   * @param interpolation
+   * @return
+   */
+  static std::vector<float> render(const SampleData &data, float pitch,
+                                   Interpolation interpolation);
+
+  /**
+   * @param key
+   * @param data Sample data key was made from.
+   * @param pitch
+   * @return Cached or new render. nullptr if render does not fit capacity.
+   */
+  Render get(const Key &key, const SampleData &data, float pitch);
+
+  void clear();
+
+  [[nodiscard]] size_t getCapacity() const;
+
+  /**
+   * @return Bytes held by cached renders.
+   */
+  [[nodiscard]] size_t getSize() const;
+
+  [[nodiscard]] size_t getHits() const;
+
+  [[nodiscard]] size_t getMisses() const;
+};
+
+}  // namespace mod
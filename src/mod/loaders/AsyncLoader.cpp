@@ -0,0 +1,106 @@
+#include "AsyncLoader.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace mod {
+
+namespace {
+
+LoadResult loadResult(TrackerLoader &loader, const std::string &path) {
+  LoadResult result;
+
+  result.path = path;
+
+  try {
+    result.mod = loader.load(path);
+  } catch (const std::exception &exception) {
+    result.error = std::current_exception();
+    result.errorMessage = exception.what();
+  }
+
+  return result;
+}
+
+}  // namespace
+
+#pragma region public constructor
+
+AsyncLoader::AsyncLoader(std::shared_ptr<TrackerLoader> loader,
+                         std::shared_ptr<ThreadPool> pool)
+    : _loader(std::move(loader)), _pool(std::move(pool)) {
+  if (this->_loader == nullptr) {
+    throw std::invalid_argument("AsyncLoader: Loader cannot be nullptr.");
+  }
+
+  if (this->_pool == nullptr) {
+    this->_pool = std::make_shared<ThreadPool>();
+  }
+}
+
+#pragma endregion
+
+#pragma region public
+
+std::shared_ptr<TrackerLoader> AsyncLoader::getLoader() const {
+  return this->_loader;
+}
+
+std::shared_ptr<ThreadPool> AsyncLoader::getPool() const {
+  return this->_pool;
+}
+
+std::future<std::shared_ptr<Mod>> AsyncLoader::loadAsync(
+    const std::string &path) const {
+  return this->_pool->submit(
+      [loader = this->_loader, path]() { return loader->load(path); });
+}
+
+void AsyncLoader::loadAsync(
+    const std::string &path,
+    std::function<void(LoadResult result)> callback) const {
+  this->_pool->submit(
+      [loader = this->_loader, path, callback = std::move(callback)]() {
+        callback(loadResult(*loader, path));
+      });
+}
+
+std::vector<LoadResult> AsyncLoader::loadBatch(
+    const std::vector<std::string> &paths,
+    const std::function<void(const LoadResult &result)> &callback) const {
+  std::vector<std::future<LoadResult>> futures;
+  // Tasks own their arguments, as throwing callback ends wait for them
+  // early.
+  const auto sharedCallback =
+      std::make_shared<const std::function<void(const LoadResult &result)>>(
+          callback);
+
+  futures.reserve(paths.size());
+
+  for (const auto &path : paths) {
+    futures.push_back(this->_pool->submit(
+        [loader = this->_loader, path, callback = sharedCallback]() {
+          LoadResult result = loadResult(*loader, path);
+
+          if (*callback != nullptr) {
+            (*callback)(result);
+          }
+
+          return result;
+        }));
+  }
+
+  std::vector<LoadResult> results;
+
+  results.reserve(paths.size());
+
+  for (auto &future : futures) {
+    results.push_back(this->_pool->await(future));
+  }
+
+  return results;
+}
+
+#pragma endregion
+
+}  // namespace mod
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "TrackerLoader.h"
+#include "mod/Mod.h"
+
+namespace mod {
+
+struct LoadResult {
+  std::string path;
+  // nullptr if loading failed.
+  std::shared_ptr<Mod> mod = nullptr;
+  std::exception_ptr error = nullptr;
+  std::string errorMessage;
+};
+
+/**
+ * Loads files through loader on thread pool. Queued loads share ownership
+ * of loader, so they may outlive async loader and other owners of loader.
+ */
+class AsyncLoader {
+ private:
+  std::shared_ptr<TrackerLoader> _loader;
+  std::shared_ptr<ThreadPool> _pool;
+
+ public:
+  /**
+   * @param loader Must not be reconfigured while loads run.
+   * @param pool If nullptr, pool with one thread per hardware thread is
+   * created.
+   * @throws invalid_argument If loader is nullptr.
+   */
+  explicit AsyncLoader(std::shared_ptr<TrackerLoader> loader,
+                       std::shared_ptr<ThreadPool> pool = nullptr);
+
+  [[nodiscard]] std::shared_ptr<TrackerLoader> getLoader() const;
+
+  [[nodiscard]] std::shared_ptr<ThreadPool> getPool() const;
+
+  /**
+   * @param path
+   * @return Mod, or exception thrown by load.
+   */
+  std::future<std::shared_ptr<Mod>> loadAsync(const std::string &path) const;
+
+  /**
+   * @param path
+   * @param callback Called on pool thread when loading finished. Exception
+   * thrown by it is lost, failure of load is passed in result instead.
+   */
+  void loadAsync(const std::string &path,
+                 std::function<void(LoadResult result)> callback) const;
+
+  /**
+   * Loads files in parallel and waits for all of them. Failure of one file
+   * does not affect others.
+   * @param paths
+   * @param callback If not nullptr, called on pool thread as each file
+   * finishes.
+   * @return Results in order of paths.
+   * @throws Exception thrown by callback. Loads queued before are still
+   * finished by pool, without waiting for them.
+   */
+  std::vector<LoadResult> loadBatch(
+      const std::vector<std::string> &paths,
+      const std::function<void(const LoadResult &result)> &callback =
+          nullptr) const;
+};
+
+}  // namespace mod
@@ -0,0 +1,69 @@
+#include "ByteReader.h"
+
+#include <fmt/format.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace mod {
+
+ByteReader::ByteReader(const uint8_t *data, size_t size)
+    : _data(data), _size(size) {}
+
+const uint8_t *ByteReader::read(size_t size) {
+  if (size > this->remaining()) {
+    const std::string message = fmt::format(
+        "Cannot read {} bytes at offset {}: only {} bytes left", size,
+        this->_position, this->remaining());
+
+    throw std::runtime_error(message);
+  }
+
+  const uint8_t *current = this->_data + this->_position;
+
+  this->_position += size;
+
+  return current;
+}
+
+void ByteReader::skip(size_t size) { (void)this->read(size); }
+
+void ByteReader::seek(size_t position) {
+  if (position > this->_size) {
+    const std::string message = fmt::format(
+        "Cannot seek to offset {}: data is {} bytes", position, this->_size);
+
+    throw std::runtime_error(message);
+  }
+
+  this->_position = position;
+}
+
+uint8_t ByteReader::readU8() { return *this->read(1); }
+
+uint16_t ByteReader::readU16Swapped() {
+  const uint8_t *bytes = this->read(2);
+
+  return (uint16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+uint16_t ByteReader::readU16() {
+  const uint8_t *bytes = this->read(2);
+
+  return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t ByteReader::readU32() {
+  const uint8_t *bytes = this->read(4);
+
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+         ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+std::string ByteReader::readString(size_t size) {
+  const auto *bytes = (const char *)this->read(size);
+
+  return {bytes, strnlen(bytes, size)};
+}
+
+}  // namespace mod
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mod {
+
+/**
+ * Bounds checked cursor over contiguous bytes. Does not own data.
+ */
+class ByteReader {
+ private:
+  const uint8_t *_data;
+  size_t _size;
+  size_t _position = 0;
+
+ public:
+  ByteReader(const uint8_t *data, size_t size);
+
+  /**
+   * @param size
+   * @throws runtime_error If less than size bytes remain.
+   * @return Pointer to current position. Position is advanced by size.
+   */
+  const uint8_t *read(size_t size);
+
+  /**
+   * @param size
+   * @throws runtime_error If less than size bytes remain.
+   */
+  void skip(size_t size);
+
+  /**
+   * @param position
+   * @throws runtime_error If position is past end.
+   */
+  void seek(size_t position);
+
+  uint8_t readU8();
+
+  /**
+   * Reads big endian value.
+   */
+  uint16_t readU16Swapped();
+
+  /**
+   * Reads little endian value.
+   */
+  uint16_t readU16();
+
+  /**
+   * Reads little endian value.
+   */
+  uint32_t readU32();
+
+  /**
+   * @param size Field size. Value ends at first zero byte.
+   */
+  std::string readString(size_t size);
+
+  [[nodiscard]] const uint8_t *data() const { return this->_data; }
+
+  [[nodiscard]] size_t size() const { return this->_size; }
+
+  [[nodiscard]] size_t tell() const { return this->_position; }
+
+  [[nodiscard]] size_t remaining() const {
+    return this->_size - this->_position;
+  }
+};
+
+}  // namespace mod
@@ -1,5 +1,12 @@
 #include "DataConvertors.h"
 
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace mod::dataconvertors {
 
 constexpr float maxSigned8 = (float)0x80 - 1.0f;
@@ -51,6 +58,161 @@ void convertFromS16(const uint8_t *value, float &target) {
   target = (float)*convertedValue / maxSigned16;
 }
 
+void convertFromU8(const uint8_t *values, float *target, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    target[i] = ((float)values[i] - maxSigned8) / maxSigned8;
+  }
+}
+
+void convertFromS8(const uint8_t *values, float *target, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    target[i] = (float)(int8_t)values[i] / maxSigned8;
+  }
+}
+
+void convertFromU16(const uint8_t *values, float *target, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    uint16_t value;
+
+    std::memcpy(&value, values + i * sizeof(value), sizeof(value));
+
+    target[i] = ((float)value - maxSigned16) / maxSigned16;
+  }
+}
+
+void convertFromS16(const uint8_t *values, float *target, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    int16_t value;
+
+    std::memcpy(&value, values + i * sizeof(value), sizeof(value));
+
+    target[i] = (float)value / maxSigned16;
+  }
+}
+
+#pragma endregion
+
+#pragma region delta decode
+
+// Prefix sum of 16 bytes or 8 words in register: log2(lanes) shifted adds
+// instead of one long dependency chain. Other targets sum scalar into
+// integers first and convert in bulk.
+#ifdef __SSE2__
+
+void decodeDeltaS8(const uint8_t *deltas, float *target, size_t count) {
+  const __m128 scale = _mm_set1_ps(maxSigned8);
+  __m128i carry = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 16 <= count; i += 16) {
+    __m128i values =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(deltas + i));
+
+    values = _mm_add_epi8(values, _mm_slli_si128(values, 1));
+    values = _mm_add_epi8(values, _mm_slli_si128(values, 2));
+    values = _mm_add_epi8(values, _mm_slli_si128(values, 4));
+    values = _mm_add_epi8(values, _mm_slli_si128(values, 8));
+    values = _mm_add_epi8(values, carry);
+
+    // Broadcast last byte as carry of next block.
+    carry = _mm_unpackhi_epi8(values, values);
+    carry = _mm_shufflehi_epi16(carry, 0xFF);
+    carry = _mm_shuffle_epi32(carry, 0xFF);
+
+    const __m128i sign = _mm_cmpgt_epi8(_mm_setzero_si128(), values);
+    const __m128i low = _mm_unpacklo_epi8(values, sign);
+    const __m128i high = _mm_unpackhi_epi8(values, sign);
+    const __m128i lowSign = _mm_srai_epi16(low, 15);
+    const __m128i highSign = _mm_srai_epi16(high, 15);
+
+    const __m128i words[4] = {
+        _mm_unpacklo_epi16(low, lowSign), _mm_unpackhi_epi16(low, lowSign),
+        _mm_unpacklo_epi16(high, highSign), _mm_unpackhi_epi16(high, highSign)};
+
+    for (size_t j = 0; j < 4; j++) {
+      _mm_storeu_ps(target + i + j * 4,
+                    _mm_div_ps(_mm_cvtepi32_ps(words[j]), scale));
+    }
+  }
+
+  auto value = (uint8_t)_mm_cvtsi128_si32(carry);
+
+  for (; i < count; i++) {
+    value = (uint8_t)(value + deltas[i]);
+    target[i] = (float)(int8_t)value / maxSigned8;
+  }
+}
+
+void decodeDeltaS16(const uint8_t *deltas, float *target, size_t count) {
+  const __m128 scale = _mm_set1_ps(maxSigned16);
+  __m128i carry = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 8 <= count; i += 8) {
+    __m128i values = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(deltas + i * sizeof(uint16_t)));
+
+    values = _mm_add_epi16(values, _mm_slli_si128(values, 2));
+    values = _mm_add_epi16(values, _mm_slli_si128(values, 4));
+    values = _mm_add_epi16(values, _mm_slli_si128(values, 8));
+    values = _mm_add_epi16(values, carry);
+
+    // Broadcast last word as carry of next block.
+    carry = _mm_shufflehi_epi16(values, 0xFF);
+    carry = _mm_shuffle_epi32(carry, 0xFF);
+
+    const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+    const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+
+    _mm_storeu_ps(target + i, _mm_div_ps(_mm_cvtepi32_ps(low), scale));
+    _mm_storeu_ps(target + i + 4, _mm_div_ps(_mm_cvtepi32_ps(high), scale));
+  }
+
+  auto value = (uint16_t)_mm_cvtsi128_si32(carry);
+
+  for (; i < count; i++) {
+    uint16_t delta;
+
+    std::memcpy(&delta, deltas + i * sizeof(delta), sizeof(delta));
+
+    value = (uint16_t)(value + delta);
+    target[i] = (float)(int16_t)value / maxSigned16;
+  }
+}
+
+#else
+
+void decodeDeltaS8(const uint8_t *deltas, float *target, size_t count) {
+  std::vector<uint8_t> values(count);
+  uint8_t value = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    value = (uint8_t)(value + deltas[i]);
+    values[i] = value;
+  }
+
+  convertFromS8(values.data(), target, count);
+}
+
+void decodeDeltaS16(const uint8_t *deltas, float *target, size_t count) {
+  std::vector<uint16_t> values(count);
+  uint16_t value = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    uint16_t delta;
+
+    std::memcpy(&delta, deltas + i * sizeof(delta), sizeof(delta));
+
+    value = (uint16_t)(value + delta);
+    values[i] = value;
+  }
+
+  convertFromS16(reinterpret_cast<const uint8_t *>(values.data()), target,
+                 count);
+}
+
+#endif
+
 #pragma endregion
 
 #pragma region convert to
@@ -103,6 +265,21 @@ void swapEndian(uint64_t *value) {
             (((*value) & 0x00000000000000ffULL) << 56));
 }
 
+void swapEndian(uint16_t *values, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    values[i] = (uint16_t)(values[i] >> 8) | (uint16_t)(values[i] << 8);
+  }
+}
+
+void swapEndian(uint32_t *values, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    values[i] = ((values[i] & 0xff000000) >> 24) |  // .
+                ((values[i] & 0x00ff0000) >> 8) |   // .
+                ((values[i] & 0x0000ff00) << 8) |   // .
+                ((values[i] & 0x000000ff) << 24);
+  }
+}
+
 uint16_t swapEndian(uint16_t value) {
   swapEndian(&value);
 
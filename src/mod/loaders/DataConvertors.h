@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace mod::dataconvertors {
@@ -14,6 +15,25 @@ void convertFromS8(const uint8_t *value, float &target);
 void convertFromU16(const uint8_t *value, float &target);
 void convertFromS16(const uint8_t *value, float &target);
 
+/**
+ * Bulk conversions of count values, written so compiler can vectorize them.
+ */
+void convertFromU8(const uint8_t *values, float *target, size_t count);
+void convertFromS8(const uint8_t *values, float *target, size_t count);
+void convertFromU16(const uint8_t *values, float *target, size_t count);
+void convertFromS16(const uint8_t *values, float *target, size_t count);
+
+/**
+ * Undo delta encoding of XM sample data and convert it. Each value is sum of
+ * previous value and stored delta, wrapping like the integer type. Prefix
+ * sum is vectorized with SSE2 where available.
+ * @param deltas Signed 8 bit, or signed 16 bit little endian deltas.
+ * @param target
+ * @param count Values, not bytes.
+ */
+void decodeDeltaS8(const uint8_t *deltas, float *target, size_t count);
+void decodeDeltaS16(const uint8_t *deltas, float *target, size_t count);
+
 void convertToU8(const float &value, uint8_t *target);
 void convertToS8(const float &value, uint8_t *target);
 void convertToU16(const float &value, uint8_t *target);
@@ -23,6 +43,9 @@ void swapEndian(uint16_t *value);
 void swapEndian(uint32_t *value);
 void swapEndian(uint64_t *value);
 
+void swapEndian(uint16_t *values, size_t count);
+void swapEndian(uint32_t *values, size_t count);
+
 uint16_t swapEndian(uint16_t value);
 uint32_t swapEndian(uint32_t value);
 uint64_t swapEndian(uint64_t value);
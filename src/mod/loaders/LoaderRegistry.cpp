@@ -0,0 +1,119 @@
+#include "LoaderRegistry.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "ModLoader.h"
+#include "PrefixedBuffer.h"
+#include "S3mLoader.h"
+#include "XmLoader.h"
+
+namespace mod {
+
+#pragma region private
+
+std::shared_ptr<TrackerLoader> LoaderRegistry::require(
+    const std::vector<char> &header) const {
+  auto loader = this->find(reinterpret_cast<const uint8_t *>(header.data()),
+                           header.size());
+
+  if (loader == nullptr) {
+    throw std::runtime_error("Unknown module format");
+  }
+
+  return loader;
+}
+
+std::vector<char> LoaderRegistry::readHeader(std::istream &stream) const {
+  if (!stream) {
+    throw std::runtime_error("Module reading error: stream bad");
+  }
+
+  std::vector<char> header(this->_probeSize);
+
+  stream.read(header.data(), (std::streamsize)header.size());
+  header.resize((size_t)stream.gcount());
+
+  return header;
+}
+
+#pragma endregion
+
+#pragma region public
+
+LoaderRegistry LoaderRegistry::createDefault() {
+  LoaderRegistry registry;
+
+  registry.add(std::make_shared<ModLoader>());
+  registry.add(std::make_shared<XmLoader>());
+  registry.add(std::make_shared<S3mLoader>());
+
+  return registry;
+}
+
+void LoaderRegistry::add(std::shared_ptr<TrackerLoader> loader) {
+  this->_probeSize = std::max(this->_probeSize, loader->getProbeSize());
+  this->_loaders.push_back(std::move(loader));
+}
+
+std::shared_ptr<TrackerLoader> LoaderRegistry::find(const uint8_t *header,
+                                                    size_t size) const {
+  std::shared_ptr<TrackerLoader> best = nullptr;
+  int bestConfidence = 0;
+
+  for (const auto &loader : this->_loaders) {
+    const int confidence = loader->probe(header, size);
+
+    if (confidence > bestConfidence) {
+      best = loader;
+      bestConfidence = confidence;
+    }
+  }
+
+  return best;
+}
+
+std::shared_ptr<Mod> LoaderRegistry::load(std::istream &stream) const {
+  std::vector<char> header = this->readHeader(stream);
+  auto loader = this->require(header);
+
+  PrefixedBuffer buffer(std::move(header), stream.rdbuf());
+  std::istream replay(&buffer);
+
+  return loader->load(replay);
+}
+
+std::shared_ptr<Mod> LoaderRegistry::load(const std::string &path) const {
+  std::ifstream stream(path, std::ios::binary);
+
+  if (!stream) {
+    throw std::runtime_error(fmt::format("Cannot open '{}'", path));
+  }
+
+  return this->require(this->readHeader(stream))->load(path);
+}
+
+ModInfo LoaderRegistry::scan(const std::string &path) const {
+  std::ifstream stream(path, std::ios::binary);
+
+  if (!stream) {
+    throw std::runtime_error(fmt::format("Cannot open '{}'", path));
+  }
+
+  std::vector<char> header = this->readHeader(stream);
+  auto loader = this->require(header);
+
+  PrefixedBuffer buffer(std::move(header), stream.rdbuf());
+  std::istream replay(&buffer);
+
+  return loader->scan(replay);
+}
+
+size_t LoaderRegistry::getProbeSize() const { return this->_probeSize; }
+
+#pragma endregion
+
+}  // namespace mod
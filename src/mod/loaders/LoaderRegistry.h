@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TrackerLoader.h"
+
+namespace mod {
+
+/**
+ * Picks loader by probing one header prefix, instead of trying loaders one
+ * by one.
+ */
+class LoaderRegistry {
+ private:
+  std::vector<std::shared_ptr<TrackerLoader>> _loaders;
+  size_t _probeSize = 0;
+
+  /**
+   * @throws runtime_error If no loader recognizes header.
+   */
+  [[nodiscard]] std::shared_ptr<TrackerLoader> require(
+      const std::vector<char> &header) const;
+
+  /**
+   * @throws runtime_error
+   */
+  [[nodiscard]] std::vector<char> readHeader(std::istream &stream) const;
+
+ public:
+  /**
+   * @return Registry with all built in loaders.
+   */
+  static LoaderRegistry createDefault();
+
+  void add(std::shared_ptr<TrackerLoader> loader);
+
+  /**
+   * @param header
+   * @param size
+   * @return Loader with highest probe confidence, nullptr if none is above
+   * zero.
+   */
+  [[nodiscard]] std::shared_ptr<TrackerLoader> find(const uint8_t *header,
+                                                    size_t size) const;
+
+  /**
+   * Stream is read forward only, sniffed prefix is replayed to loader.
+   * @param stream
+   * @throws runtime_error
+   */
+  [[nodiscard]] std::shared_ptr<Mod> load(std::istream &stream) const;
+
+  /**
+   * @param path
+   * @throws runtime_error
+   */
+  [[nodiscard]] std::shared_ptr<Mod> load(const std::string &path) const;
+
+  /**
+   * @param path
+   * @throws runtime_error
+   */
+  [[nodiscard]] ModInfo scan(const std::string &path) const;
+
+  /**
+   * @return Bytes of header loaders need for probing.
+   */
+  [[nodiscard]] size_t getProbeSize() const;
+};
+
+}  // namespace mod
@@ -2,106 +2,150 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <optional>
 
 #include "DataConvertors.h"
-#include "StreamUtils.h"
+#include "MappedFile.h"
 
 namespace mod {
 
-#pragma region private static
-
-Note ModLoader::serializeNote(std::istream &stream) {
-  constexpr size_t noteDataSize = 4;
-
-  std::array<uint8_t, noteDataSize> data{};
-
-  if (!stream) {
-    throw std::runtime_error("Cannot serialize note: stream bad");
+namespace {
+
+/**
+ * Waits for all pending futures when leaving scope. Tasks reference locals
+ * of their submitter, so stack must not unwind while any of them runs, e.g.
+ * after another one failed.
+ */
+template <class T>
+class PendingTasks {
+ private:
+  ThreadPool &_pool;
+  std::vector<std::future<T>> &_futures;
+
+ public:
+  PendingTasks(ThreadPool &pool, std::vector<std::future<T>> &futures)
+      : _pool(pool), _futures(futures) {}
+
+  PendingTasks(const PendingTasks &) = delete;
+  PendingTasks &operator=(const PendingTasks &) = delete;
+
+  ~PendingTasks() {
+    for (const auto &future : this->_futures) {
+      if (future.valid()) {
+        this->_pool.wait(future);
+      }
+    }
   }
+};
 
-  stream.read((char *)data.data(), data.size());
+}  // namespace
 
-  if (!stream) {
-    const std::string message = fmt::format(
-        "Cannot serialize note: stream gone bad after trying to read {} bytes",
-        noteDataSize);
+#pragma region private static
 
-    throw std::runtime_error(message);
+class ModLoader::LazyModDecoder : public LazyDecoder {
+ private:
+  static constexpr size_t totalRows = 64;
+  static constexpr size_t noteDataSize = 4;
+
+  // Keeps data alive until mod is destroyed.
+  std::shared_ptr<const void> _owner;
+  const uint8_t *_data;
+  size_t _channels;
+  size_t _patternsOffset;
+  std::vector<size_t> _sampleOffsets;
+  std::shared_ptr<SampleStore> _sampleStore;
+
+ public:
+  LazyModDecoder(std::shared_ptr<const void> owner, const uint8_t *data,
+                 size_t channels, size_t patternsOffset,
+                 std::vector<size_t> sampleOffsets,
+                 std::shared_ptr<SampleStore> sampleStore)
+      : _owner(std::move(owner)),
+        _data(data),
+        _channels(channels),
+        _patternsOffset(patternsOffset),
+        _sampleOffsets(std::move(sampleOffsets)),
+        _sampleStore(std::move(sampleStore)) {}
+
+  [[nodiscard]] Pattern decodePattern(size_t index) const override {
+    const size_t patternSize = this->_channels * totalRows * noteDataSize;
+    ByteReader reader(this->_data + this->_patternsOffset + index * patternSize,
+                      patternSize);
+
+    return ModLoader::serializePattern(reader, this->_channels, totalRows);
   }
 
-  int sampleNumber = (data[0] & 0xF0) | (data[2] >> 4);
-  int samplePeriodFrequency = ((data[0] & 0xF) << 8) | data[1];
-  int effectNumber = (data[2] & 0xF);
-  int effectParameter = data[3];
-
-  Note outNote{};
-
-  outNote.sampleIndex = sampleNumber;
-  outNote.samplePeriodFrequency = samplePeriodFrequency;
-  outNote.effectNumber = effectNumber;
-  outNote.effectParameter = effectParameter;
-
-  return outNote;
-}
-
-Row ModLoader::serializeRow(std::istream &stream, size_t channels) {
-  if (!stream) {
-    throw std::runtime_error("Cannot serialize row: stream bad");
+  void decodeSample(size_t index, Sample &sample) const override {
+    ModLoader::decodeSampleData(this->_data + this->_sampleOffsets[index],
+                                sample, Encoding::Signed8,
+                                this->_sampleStore.get());
   }
+};
 
-  Row outRow(channels);
 
-  for (auto i = 0; i < channels; i++) {
-    Note readNote = ModLoader::serializeNote(stream);
+void ModLoader::decodeNotes(const uint8_t *data, Note *notes, size_t count) {
+  for (size_t i = 0; i < count; i++, data += sizeof(uint32_t)) {
+    // Big endian word, compilers turn this into single load and swap.
+    const uint32_t word = ((uint32_t)data[0] << 24) |
+                          ((uint32_t)data[1] << 16) |
+                          ((uint32_t)data[2] << 8) | (uint32_t)data[3];
 
-    outRow.addNote(readNote);
+    notes[i].sampleIndex = (int)(((word >> 24) & 0xF0) | ((word >> 12) & 0xF));
+    notes[i].samplePeriodFrequency = (int)((word >> 16) & 0xFFF);
+    notes[i].effectNumber = (int)((word >> 8) & 0xF);
+    notes[i].effectParameter = (int)(word & 0xFF);
   }
-
-  return outRow;
 }
 
-Pattern ModLoader::serializePattern(std::istream &stream, size_t channels,
+Pattern ModLoader::serializePattern(ByteReader &reader, size_t channels,
                                     size_t totalRows) {
-  if (!stream) {
-    throw std::runtime_error("Cannot serialize pattern: stream bad");
-  }
+  constexpr size_t noteDataSize = 4;
+
+  const size_t notesCount = channels * totalRows;
+  const uint8_t *data = reader.read(notesCount * noteDataSize);
 
   Pattern outPattern(channels, totalRows);
 
-  for (auto i = 0; i < totalRows; i++) {
-    Row readRow = ModLoader::serializeRow(stream, channels);
+  // Notes are unpacked straight into vector of each row.
+  for (size_t i = 0; i < totalRows; i++) {
+    std::vector<Note> notes(channels);
 
-    outPattern.addRow(readRow);
+    ModLoader::decodeNotes(data + i * channels * noteDataSize, notes.data(),
+                           channels);
+    outPattern.addRow(Row(std::move(notes)));
   }
 
   return outPattern;
 }
 
-Sample ModLoader::serializeSample(std::istream &stream) {
-  if (!stream) {
-    throw std::runtime_error("Cannot serialize sample: stream bad");
-  }
-
+Sample ModLoader::serializeSample(ByteReader &reader) {
   constexpr size_t nameLength = 22;
-  std::string sampleName(nameLength + 1, '\0');
 
-  stream.read(sampleName.data(), nameLength);
-  sampleName.resize(sampleName.find('\0'));
+  std::string sampleName = reader.readString(nameLength);
+
+  // Length, finetune and volume, repeat point, repeat length.
+  std::array<uint16_t, 4> fields{};
 
-  int length = streamutils::readU16Swapped(stream);
+  std::memcpy(fields.data(), reader.read(sizeof(fields)), sizeof(fields));
+  dataconvertors::swapEndian(fields.data(), fields.size());
+
+  int length = fields[0];
 
   length *= 2;
 
-  uint8_t finetune = streamutils::readU8(stream);
+  auto finetune = (uint8_t)(fields[1] >> 8);
 
-  uint8_t volume = streamutils::readU8(stream);
+  auto volume = (uint8_t)(fields[1] & 0xFF);
 
-  int repeatPoint = streamutils::readU16Swapped(stream);
+  int repeatPoint = fields[2];
   repeatPoint *= 2;
 
-  int repeatLength = streamutils::readU16Swapped(stream);
+  int repeatLength = fields[3];
 
   if (repeatLength == 1) {
     repeatLength = 0;
@@ -109,31 +153,21 @@ Sample ModLoader::serializeSample(std::istream &stream) {
     repeatLength *= 2;
   }
 
-  if (!stream) {
-    throw std::runtime_error("Cannot serialize sample: stream gone bad");
-  }
-
   return {sampleName,  length,       finetune, volume,
           repeatPoint, repeatLength, 8363.0f};
 }
 
-size_t ModLoader::getChannels(std::istream &stream) {
-  if (!stream) {
-    throw std::runtime_error("File stream bad.");
-  }
-
-  std::ifstream::pos_type pos = stream.tellg();
+size_t ModLoader::getChannels(const uint8_t *data, size_t size) {
+  constexpr size_t typeOffset = 1080;
+  constexpr size_t typeLength = 4;
 
-  stream.seekg(1080, std::ios_base::beg);
+  if (size < typeOffset + typeLength) {
+    throw std::runtime_error("Mod is too short to contain type.");
+  }
 
   std::string type(5, '\0');
 
-  stream.read(type.data(), 4);
-  stream.seekg(pos, std::ios_base::beg);
-
-  if (!stream) {
-    throw std::runtime_error("File stream gone bad.");
-  }
+  std::memcpy(type.data(), data + typeOffset, typeLength);
 
   if (std::strcmp(type.data(), "M.K.") == 0 ||
       std::strcmp(type.data(), "FLT4") == 0) {
@@ -157,18 +191,14 @@ size_t ModLoader::getChannels(std::istream &stream) {
   throw std::runtime_error(fmt::format("Unknown mod type format: '{}'", type));
 }
 
-std::vector<Sample> ModLoader::readSamples(std::istream &stream) {
-  if (!stream) {
-    throw std::runtime_error("Samples reading error: stream bad.");
-  }
-
+std::vector<Sample> ModLoader::readSamples(ByteReader &reader) {
   std::vector<Sample> samples;
 
   constexpr size_t samplesTotal = 31;
   samples.reserve(samplesTotal);
 
   for (int i = 0; i < samplesTotal; i++) {
-    Sample sample = ModLoader::serializeSample(stream);
+    Sample sample = ModLoader::serializeSample(reader);
 
     samples.push_back(sample);
   }
@@ -176,34 +206,73 @@ std::vector<Sample> ModLoader::readSamples(std::istream &stream) {
   return samples;
 }
 
-std::vector<Pattern> ModLoader::readPatterns(std::istream &stream,
-                                             size_t patternsNumber) {
-  if (!stream) {
-    throw std::runtime_error("Patterns reading error: stream bad.");
+std::vector<Pattern> ModLoader::readPatterns(ByteReader &reader,
+                                             size_t channels,
+                                             const std::vector<bool> &reachable,
+                                             ThreadPool *pool) {
+  constexpr size_t totalRows = 64;
+  constexpr size_t noteDataSize = 4;
+
+  const size_t patternSize = channels * totalRows * noteDataSize;
+  const uint8_t *data = reader.read(patternSize * reachable.size());
+
+  std::vector<size_t> indexes;
+
+  for (size_t i = 0; i < reachable.size(); i++) {
+    if (reachable[i]) {
+      indexes.push_back(i);
+    }
   }
 
-  std::vector<Pattern> patterns;
-  size_t channels = ModLoader::getChannels(stream);
+  const auto decodeRange = [&](size_t begin, size_t end) {
+    std::vector<Pattern> decoded;
+
+    decoded.reserve(end - begin);
+
+    for (size_t i = begin; i < end; i++) {
+      ByteReader patternReader(data + indexes[i] * patternSize, patternSize);
+
+      decoded.push_back(
+          ModLoader::serializePattern(patternReader, channels, totalRows));
+    }
+
+    return decoded;
+  };
+
+  if (pool == nullptr) {
+    return decodeRange(0, indexes.size());
+  }
+
+  const size_t chunks = pool->getThreadCount() * 2;
+  const size_t chunkSize = (indexes.size() + chunks - 1) / chunks;
 
-  patterns.reserve(patternsNumber);
+  std::vector<std::future<std::vector<Pattern>>> futures;
+  const PendingTasks<std::vector<Pattern>> pending(*pool, futures);
 
-  for (auto i = 0; i < patternsNumber; i++) {
-    Pattern pattern = ModLoader::serializePattern(stream, channels, 64);
+  for (size_t begin = 0; begin < indexes.size(); begin += chunkSize) {
+    const size_t end = std::min(begin + chunkSize, indexes.size());
 
-    patterns.push_back(pattern);
+    futures.push_back(
+        pool->submit([&decodeRange, begin, end]() { return decodeRange(begin, end); }));
   }
 
-  return patterns;
-}
+  std::vector<Pattern> patterns;
 
-void ModLoader::readSamplesAudioData(std::istream &stream,
-                                     std::vector<Sample> &samples,
-                                     Encoding audioDataEncoding) {
-  if (!stream) {
-    throw std::runtime_error("Sample audio data reading error: stream bad.");
+  patterns.reserve(indexes.size());
+
+  for (auto &future : futures) {
+    for (auto &pattern : pool->await(future)) {
+      patterns.push_back(std::move(pattern));
+    }
   }
 
-  void (*convertor)(const uint8_t *, float &);
+  return patterns;
+}
+
+void ModLoader::decodeSampleData(const uint8_t *data, Sample &sample,
+                                 Encoding audioDataEncoding,
+                                 SampleStore *sampleStore) {
+  void (*convertor)(const uint8_t *, float *, size_t);
 
   if (audioDataEncoding == Encoding::Signed8) {
     convertor = &dataconvertors::convertFromS8;
@@ -215,118 +284,384 @@ void ModLoader::readSamplesAudioData(std::istream &stream,
     convertor = &dataconvertors::convertFromU16;
   } else {
     throw std::invalid_argument(
-        "readSamplesAudioData: unknown audio data encoding: " +
+        "decodeSampleData: unknown audio data encoding: " +
         encodingToString(audioDataEncoding));
   }
 
-  for (auto &sample : samples) {
-    sample.reserveData();
+  std::vector<float> sampleData(sample.getLength());
+
+  convertor(data, sampleData.data(), sampleData.size());
+
+  if (sampleStore != nullptr) {
+    sample.setData(sampleStore->intern(std::move(sampleData)));
+  } else {
+    sample.setData(std::move(sampleData));
+  }
+}
+
+void ModLoader::readSamplesAudioData(ByteReader &reader,
+                                     std::vector<Sample> &samples,
+                                     Encoding audioDataEncoding,
+                                     const std::vector<bool> &usedSamples,
+                                     SampleStore *sampleStore,
+                                     ThreadPool *pool) {
+  // All ranges are read before decoding starts, so truncated data fails
+  // before any task is submitted.
+  std::vector<const uint8_t *> sampleData(samples.size(), nullptr);
+
+  for (size_t sampleIndex = 0; sampleIndex < samples.size(); sampleIndex++) {
+    const size_t dataSize =
+        samples[sampleIndex].getLength() * bytesInEncoding(audioDataEncoding);
+
+    if (usedSamples[sampleIndex]) {
+      sampleData[sampleIndex] = reader.read(dataSize);
+    } else {
+      reader.skip(dataSize);
+    }
+  }
+
+  std::vector<std::future<void>> futures;
+  std::optional<PendingTasks<void>> pending;
+
+  if (pool != nullptr) {
+    pending.emplace(*pool, futures);
+  }
 
-    std::vector<uint8_t> readData(sample.getLength());
+  for (size_t sampleIndex = 0; sampleIndex < samples.size(); sampleIndex++) {
+    Sample &sample = samples[sampleIndex];
+    const uint8_t *data = sampleData[sampleIndex];
 
-    stream.read((char *)readData.data(), sample.getLength());
+    if (!usedSamples[sampleIndex]) {
+      sample = Sample(sample.getName(), 0, sample.getFinetune(),
+                      sample.getVolume(), 0, 0, sample.getDataFrequency());
+      continue;
+    }
 
-    if (!stream) {
-      throw std::runtime_error(
-          "Sample audio data reading error: stream gone bad.");
+    if (pool == nullptr) {
+      ModLoader::decodeSampleData(data, sample, audioDataEncoding,
+                                  sampleStore);
+    } else {
+      futures.push_back(pool->submit([=, &sample]() {
+        ModLoader::decodeSampleData(data, sample, audioDataEncoding,
+                                    sampleStore);
+      }));
     }
+  }
+
+  for (auto &future : futures) {
+    pool->await(future);
+  }
+}
+
+std::vector<bool> ModLoader::pruneOrders(std::vector<int> &orders,
+                                         size_t songLength,
+                                         size_t patternsCount) {
+  std::vector<bool> reachable(patternsCount, false);
 
-    std::vector<float> &sampleData = sample.getData();
+  for (size_t i = 0; i < songLength && i < orders.size(); i++) {
+    reachable[orders[i]] = true;
+  }
+
+  std::vector<int> remap(patternsCount, 0);
+  int keptPatterns = 0;
 
-    for (auto i = 0; i < sample.getLength(); i++) {
-      convertor(&readData[i], sampleData[i]);
+  for (size_t i = 0; i < patternsCount; i++) {
+    if (reachable[i]) {
+      remap[i] = keptPatterns++;
     }
   }
+
+  for (size_t i = 0; i < orders.size(); i++) {
+    orders[i] = i < songLength ? remap[orders[i]] : 0;
+  }
+
+  return reachable;
 }
 
-std::vector<int> ModLoader::readOrders(std::istream &stream) {
-  if (!stream) {
-    throw std::runtime_error("Orders reading error: stream bad.");
+std::vector<bool> ModLoader::findUsedSamples(
+    const std::vector<Pattern> &patterns, size_t samplesCount) {
+  std::vector<bool> used(samplesCount, false);
+
+  for (const auto &pattern : patterns) {
+    for (const auto &row : pattern.getRows()) {
+      for (const auto &note : row.getNotes()) {
+        if (note.sampleIndex > 0 && note.sampleIndex <= samplesCount) {
+          used[note.sampleIndex - 1] = true;
+        }
+      }
+    }
   }
 
+  return used;
+}
+
+std::vector<int> ModLoader::readOrders(ByteReader &reader) {
   constexpr size_t totalOrders = 128;
 
-  std::vector<uint8_t> orders;
+  const uint8_t *orders = reader.read(totalOrders);
 
-  orders.resize(totalOrders);
-  stream.read((char *)orders.data(), totalOrders);
+  return {orders, orders + totalOrders};
+}
 
-  if (!stream) {
-    throw std::runtime_error("Orders reading error: stream gone bad.");
-  }
+std::string ModLoader::readName(ByteReader &reader) {
+  constexpr size_t nameLength = 20;
 
-  std::vector<int> convertedOrders;
-  convertedOrders.reserve(totalOrders);
+  return reader.readString(nameLength);
+}
+
+size_t ModLoader::countPatterns(const std::vector<int> &orders) {
+  int patternsCount = 0;
 
   for (auto order : orders) {
-    convertedOrders.push_back((int)order);
+    if (order > patternsCount) {
+      patternsCount = order;
+    }
   }
 
-  return convertedOrders;
+  return patternsCount + 1;
 }
 
-std::string ModLoader::readName(std::istream &stream) {
-  if (!stream) {
-    throw std::runtime_error("Mod name reading error: stream is bad.");
+ModInfo ModLoader::scanHeader(const uint8_t *data, size_t size) {
+  // Default speed 6 ticks per row at 125 BPM, 50 ticks per second.
+  constexpr float secondsPerRow = 6.0f / 50.0f;
+  constexpr size_t totalRows = 64;
+
+  ByteReader reader(data, size);
+  ModInfo info;
+
+  info.name = ModLoader::readName(reader);
+
+  for (const auto &sample : ModLoader::readSamples(reader)) {
+    info.sampleNames.push_back(sample.getName());
   }
 
-  std::string name(21, '\0');
+  info.songLength = reader.readU8();
 
-  stream.read(name.data(), 20);
+  // Restart position, unused.
+  reader.skip(1);
 
-  if (!stream) {
-    throw std::runtime_error("Mod name reading error: stream gone bad.");
+  info.patternCount = ModLoader::countPatterns(ModLoader::readOrders(reader));
+  info.channels = ModLoader::getChannels(data, size);
+  info.estimatedDuration =
+      (float)(info.songLength * totalRows) * secondsPerRow;
+
+  return info;
+}
+
+std::shared_ptr<Mod> ModLoader::parse(
+    const uint8_t *data, size_t size,
+    const std::shared_ptr<const void> &owner) const {
+  ByteReader reader(data, size);
+
+  std::string name = ModLoader::readName(reader);
+  std::vector<Sample> samples = ModLoader::readSamples(reader);
+
+  size_t songLength = reader.readU8();
+
+  // Restart position, unused.
+  reader.skip(1);
+
+  std::vector<int> orders = ModLoader::readOrders(reader);
+
+  // Type, read by getChannels.
+  reader.skip(4);
+
+  const size_t channels = ModLoader::getChannels(data, size);
+
+  const size_t patternsCount = ModLoader::countPatterns(orders);
+
+  if (this->_lazy) {
+    return this->createLazy(reader, std::move(name), songLength, channels,
+                            std::move(samples), patternsCount,
+                            std::move(orders), owner);
+  }
+
+  ThreadPool *pool = nullptr;
+
+  if (this->_threadPool != nullptr && size >= this->_parallelThreshold) {
+    pool = this->_threadPool.get();
+  }
+
+  std::vector<bool> reachable(patternsCount, true);
+
+  if (this->_pruneUnused) {
+    reachable = ModLoader::pruneOrders(orders, songLength, patternsCount);
+  }
+
+  std::vector<Pattern> patterns =
+      ModLoader::readPatterns(reader, channels, reachable, pool);
+  std::vector<bool> usedSamples(samples.size(), true);
+
+  if (this->_pruneUnused) {
+    usedSamples = ModLoader::findUsedSamples(patterns, samples.size());
+  }
+
+  ModLoader::readSamplesAudioData(reader, samples, Encoding::Signed8,
+                                  usedSamples, this->_sampleStore.get(),
+                                  pool);
+
+  return std::make_shared<Mod>(name, songLength, std::move(samples),
+                               std::move(patterns), std::move(orders));
+}
+
+std::shared_ptr<Mod> ModLoader::createLazy(
+    ByteReader &reader, std::string name, size_t songLength, size_t channels,
+    std::vector<Sample> samples, size_t patternsCount, std::vector<int> orders,
+    const std::shared_ptr<const void> &owner) const {
+  constexpr size_t totalRows = 64;
+  constexpr size_t noteDataSize = 4;
+
+  const size_t patternsOffset = reader.tell();
+
+  reader.skip(channels * totalRows * noteDataSize * patternsCount);
+
+  std::vector<size_t> sampleOffsets;
+
+  sampleOffsets.reserve(samples.size());
+
+  for (const auto &sample : samples) {
+    sampleOffsets.push_back(reader.tell());
+    reader.skip(sample.getLength() * bytesInEncoding(Encoding::Signed8));
   }
 
-  name.resize(name.find('\0'));
+  std::shared_ptr<const void> dataOwner = owner;
+  const uint8_t *data = reader.data();
+
+  if (dataOwner == nullptr) {
+    auto copy =
+        std::make_shared<const std::vector<uint8_t>>(data, data + reader.size());
+
+    data = copy->data();
+    dataOwner = std::move(copy);
+  }
+
+  auto decoder = std::make_shared<const LazyModDecoder>(
+      std::move(dataOwner), data, channels, patternsOffset,
+      std::move(sampleOffsets), this->_sampleStore);
+
+  auto mod = std::make_shared<Mod>(std::move(name), songLength, channels,
+                                   std::move(samples), patternsCount,
+                                   std::move(orders), std::move(decoder));
+
+  if (songLength > 0) {
+    mod->prefetch(0);
+  }
 
-  return name;
+  return mod;
 }
 
 #pragma endregion
 
+int ModLoader::probe(const uint8_t *header, size_t size) const {
+  constexpr size_t typeOffset = 1080;
+
+  if (size < typeOffset + 4) {
+    return 0;
+  }
+
+  const char *type = reinterpret_cast<const char *>(header + typeOffset);
+  const auto isDigit = [](char character) {
+    return character >= '0' && character <= '9';
+  };
+
+  // Same tags as getChannels accepts.
+  if (std::memcmp(type, "M.K.", 4) == 0 || std::memcmp(type, "FLT4", 4) == 0 ||
+      std::memcmp(type, "6CHN", 4) == 0 || std::memcmp(type, "8CHN", 4) == 0 ||
+      (isDigit(type[0]) && isDigit(type[1]) &&
+       std::memcmp(type + 2, "CH", 2) == 0)) {
+    return 100;
+  }
+
+  return 0;
+}
+
+size_t ModLoader::getProbeSize() const { return 1084; }
+
+void ModLoader::setPruneUnused(bool pruneUnused) {
+  this->_pruneUnused = pruneUnused;
+}
+
+bool ModLoader::getPruneUnused() const { return this->_pruneUnused; }
+
+void ModLoader::setLazy(bool lazy) { this->_lazy = lazy; }
+
+bool ModLoader::getLazy() const { return this->_lazy; }
+
+void ModLoader::setSampleStore(std::shared_ptr<SampleStore> sampleStore) {
+  this->_sampleStore = std::move(sampleStore);
+}
+
+std::shared_ptr<SampleStore> ModLoader::getSampleStore() const {
+  return this->_sampleStore;
+}
+
+void ModLoader::setThreadPool(std::shared_ptr<ThreadPool> threadPool,
+                              size_t parallelThreshold) {
+  this->_threadPool = std::move(threadPool);
+  this->_parallelThreshold = parallelThreshold;
+}
+
+std::shared_ptr<ThreadPool> ModLoader::getThreadPool() const {
+  return this->_threadPool;
+}
+
 std::shared_ptr<Mod> ModLoader::load(std::istream &stream) {
   if (!stream) {
     throw std::runtime_error("Mod reading error: stream bad");
   }
 
-  std::string name = ModLoader::readName(stream);
-  std::vector<Sample> samples = ModLoader::readSamples(stream);
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)),
+                            std::istreambuf_iterator<char>());
 
-  uint8_t byte;
+  return this->parse(data.data(), data.size(), nullptr);
+}
 
-  stream.read((char *)(&byte), 1);
-  size_t songLength = (int)byte;
+std::shared_ptr<Mod> ModLoader::load(const std::string &path) {
+  auto file = std::make_shared<const MappedFile>(path);
 
-  uint8_t unused;
-  stream.read((char *)(&unused), 1);
+  return this->parse(file->data(), file->size(), file);
+}
 
-  std::vector<int> orders = ModLoader::readOrders(stream);
+std::shared_ptr<Mod> ModLoader::load(const uint8_t *data, size_t size) {
+  return this->parse(data, size, nullptr);
+}
 
-  stream.seekg(4, std::ios_base::cur);
+std::unique_ptr<StreamingLoad> ModLoader::loadStreaming(
+    std::istream &stream) const {
+  if (!stream) {
+    throw std::runtime_error("Mod reading error: stream bad");
+  }
 
-  int patternsCount = 0;
+  return std::make_unique<StreamingLoad>(stream, this->_sampleStore);
+}
 
-  for (auto order : orders) {
-    if (order > patternsCount) {
-      patternsCount = order;
-    }
+ModInfo ModLoader::scan(std::istream &stream) {
+  if (!stream) {
+    throw std::runtime_error("Mod reading error: stream bad");
   }
-  patternsCount++;
 
-  std::vector<Pattern> patterns =
-      ModLoader::readPatterns(stream, patternsCount);
+  constexpr size_t headerSize = 1084;
 
-  ModLoader::readSamplesAudioData(stream, samples, Encoding::Signed8);
+  std::array<uint8_t, headerSize> header{};
 
-  return std::make_shared<Mod>(name, songLength, std::move(samples),
-                               std::move(patterns), std::move(orders));
+  stream.read(reinterpret_cast<char *>(header.data()), header.size());
+
+  return ModLoader::scanHeader(header.data(), stream.gcount());
 }
 
-std::shared_ptr<Mod> ModLoader::load(const std::string &path) {
-  std::ifstream stream(path);
+ModInfo ModLoader::scan(const std::string &path) {
+  std::ifstream stream(path, std::ios::binary);
+
+  if (!stream) {
+    throw std::runtime_error(
+        fmt::format("Mod reading error: cannot open '{}'", path));
+  }
+
+  return this->scan(stream);
+}
 
-  return this->load(stream);
+ModInfo ModLoader::scan(const uint8_t *data, size_t size) {
+  return ModLoader::scanHeader(data, size);
 }
 
-}  // namespace mod
\ No newline at end of file
+}  // namespace mod
@@ -3,88 +3,273 @@
 #include <istream>
 #include <memory>
 
+#include "ByteReader.h"
+#include "StreamingLoad.h"
+#include "ThreadPool.h"
 #include "TrackerLoader.h"
 #include "mod/Mod.h"
+#include "mod/SampleStore.h"
 
 namespace mod {
 
 class ModLoader : public TrackerLoader {
  private:
+  friend class StreamingLoad;
+
+  class LazyModDecoder;
+
   /**
-   *
-   * @param stream
+   * Unpacks count 4 byte big endian notes, without allocating.
+   * @param data
+   * @param notes
+   * @param count
+   */
+  static void decodeNotes(const uint8_t *data, Note *notes, size_t count);
+
+  /**
+   * Decodes whole pattern block with single bounds check.
+   * @param reader
+   * @param channels
+   * @param totalRows
    * @throws runtime_error
    * @return
    */
-  static Note serializeNote(std::istream &stream);
+  static Pattern serializePattern(ByteReader &reader, size_t channels,
+                                  size_t totalRows);
 
   /**
    *
-   * @param stream
+   * @param reader
    * @throws runtime_error
    * @return
    */
-  static Row serializeRow(std::istream &stream, size_t channels);
+  static Sample serializeSample(ByteReader &reader);
 
   /**
-   *
-   * @param stream
-   * @param channels
-   * @param totalRows
+   * @param data Whole module.
+   * @param size
    * @throws runtime_error
    * @return
    */
-  static Pattern serializePattern(std::istream &stream, size_t channels,
-                         size_t totalRows);
+  [[nodiscard]] static size_t getChannels(const uint8_t *data, size_t size);
+  /**
+   * @param reader
+   * @throws runtime_error
+   */
+  [[nodiscard]] static std::vector<Sample> readSamples(ByteReader &reader);
+  /**
+   * Decodes patterns marked as reachable and skips the rest.
+   * @param reader
+   * @param channels
+   * @param reachable Pattern indexes to decode.
+   * @param pool If not nullptr, patterns are decoded by its threads.
+   * @throws runtime_error
+   */
+  [[nodiscard]] static std::vector<Pattern> readPatterns(
+      ByteReader &reader, size_t channels, const std::vector<bool> &reachable,
+      ThreadPool *pool);
+  /**
+   * Converts sample audio data and sets it to sample.
+   * @param data
+   * @param sample
+   * @param audioDataEncoding
+   * @param sampleStore If not nullptr, decoded data is interned in it.
+   * @throws invalid_argument
+   */
+  static void decodeSampleData(const uint8_t *data, Sample &sample,
+                               Encoding audioDataEncoding,
+                               SampleStore *sampleStore);
+  /**
+   * Samples not marked as used are skipped and left without data.
+   * @param reader
+   * @param samples
+   * @param audioDataEncoding
+   * @param usedSamples
+   * @param sampleStore See decodeSampleData.
+   * @param pool If not nullptr, samples are decoded by its threads.
+   * @throws runtime_error
+   * @throws invalid_argument
+   */
+  static void readSamplesAudioData(ByteReader &reader,
+                                   std::vector<Sample> &samples,
+                                   Encoding audioDataEncoding,
+                                   const std::vector<bool> &usedSamples,
+                                   SampleStore *sampleStore,
+                                   ThreadPool *pool);
+  /**
+   * Marks patterns played within song length and remaps orders to indexes
+   * of kept patterns.
+   * @param orders
+   * @param songLength
+   * @param patternsCount
+   * @return Reachable patterns.
+   */
+  [[nodiscard]] static std::vector<bool> pruneOrders(std::vector<int> &orders,
+                                                     size_t songLength,
+                                                     size_t patternsCount);
+  /**
+   * @param patterns
+   * @param samplesCount
+   * @return Samples triggered by at least one note.
+   */
+  [[nodiscard]] static std::vector<bool> findUsedSamples(
+      const std::vector<Pattern> &patterns, size_t samplesCount);
+  /**
+   * @param reader
+   * @throws runtime_error
+   */
+  [[nodiscard]] static std::vector<int> readOrders(ByteReader &reader);
+  /**
+   * @param reader
+   * @throws runtime_error
+   */
+  [[nodiscard]] static std::string readName(ByteReader &reader);
+  /**
+   * @param orders
+   * @return Highest pattern index in orders plus one.
+   */
+  [[nodiscard]] static size_t countPatterns(const std::vector<int> &orders);
+  /**
+   * @param data At least header long.
+   * @param size
+   * @throws runtime_error
+   */
+  [[nodiscard]] static ModInfo scanHeader(const uint8_t *data, size_t size);
 
   /**
-   *
-   * @param stream
+   * @param data Whole module.
+   * @param size
+   * @param owner If not nullptr, owns data. Lazy mod keeps it to decode
+   * from, otherwise it is not referenced after return.
    * @throws runtime_error
-   * @return
    */
-  static Sample serializeSample(std::istream &stream);
+  [[nodiscard]] std::shared_ptr<Mod> parse(
+      const uint8_t *data, size_t size,
+      const std::shared_ptr<const void> &owner) const;
 
+  /**
+   * Validates pattern and sample ranges and creates mod decoding them on
+   * first access. Data is copied if there is no owner.
+   * @param reader Positioned at first pattern.
+   * @param owner See parse.
+   * @throws runtime_error
+   */
+  [[nodiscard]] std::shared_ptr<Mod> createLazy(
+      ByteReader &reader, std::string name, size_t songLength,
+      size_t channels, std::vector<Sample> samples, size_t patternsCount,
+      std::vector<int> orders, const std::shared_ptr<const void> &owner) const;
+
+ private:
+  bool _pruneUnused = false;
+  bool _lazy = false;
+  std::shared_ptr<SampleStore> _sampleStore = nullptr;
+  std::shared_ptr<ThreadPool> _threadPool = nullptr;
+  size_t _parallelThreshold = 0;
+
+ public:
+  ~ModLoader() override = default;
+
+  /**
+   * Checks type tag at offset 1080.
+   * @param header
+   * @param size
+   * @return 100 for known tag, 0 otherwise.
+   */
+  [[nodiscard]] int probe(const uint8_t *header, size_t size) const override;
+
+  [[nodiscard]] size_t getProbeSize() const override;
+
+  /**
+   * When enabled, only patterns reachable within song length and samples
+   * they trigger are decoded. Pruned samples are kept with zero length, so
+   * note sample indexes stay valid.
+   * @param pruneUnused
+   */
+  void setPruneUnused(bool pruneUnused);
+
+  [[nodiscard]] bool getPruneUnused() const;
+
+  /**
+   * When enabled, patterns and sample data are decoded on first access, see
+   * Mod. Only pattern of first order and samples it triggers are decoded by
+   * load, Generator decodes the rest ahead on its decode pool. Pruning is
+   * not applied, as unused parts are never decoded anyway.
+   * @param lazy
+   */
+  void setLazy(bool lazy);
+
+  [[nodiscard]] bool getLazy() const;
+
+  /**
+   * @param sampleStore If set, identical sample data of loaded mods is
+   * shared through it. SampleStore::global() is process wide store.
+   */
+  void setSampleStore(std::shared_ptr<SampleStore> sampleStore);
+
+  [[nodiscard]] std::shared_ptr<SampleStore> getSampleStore() const;
 
   /**
+   * @param threadPool If set, patterns and sample data of modules of at
+   * least parallelThreshold bytes are decoded by its threads.
+   * @param parallelThreshold
+   */
+  void setThreadPool(std::shared_ptr<ThreadPool> threadPool,
+                     size_t parallelThreshold = 256 * 1024);
+
+  [[nodiscard]] std::shared_ptr<ThreadPool> getThreadPool() const;
+
+  /**
+   * Reads rest of stream into memory and parses it.
    * @param stream
    * @throws runtime_error
-   * @return
    */
-  [[nodiscard]] static size_t getChannels(std::istream &stream);
+  std::shared_ptr<Mod> load(std::istream &stream) override;
+
   /**
-   * @param stream
+   * Maps file into memory and parses it from mapping. Sample data is
+   * converted straight from mapping, which is unmapped after load. Lazy mod
+   * keeps mapping while it is alive, to decode from it.
+   * @param path
    * @throws runtime_error
    */
-  [[nodiscard]] static std::vector<Sample> readSamples(std::istream &stream);
+  std::shared_ptr<Mod> load(const std::string &path) override;
+
   /**
-   * @param stream
+   * @param data Whole module. Not referenced after return.
+   * @param size
    * @throws runtime_error
    */
-  [[nodiscard]] static std::vector<Pattern> readPatterns(std::istream &stream,
-                                                         size_t patternsNumber);
+  std::shared_ptr<Mod> load(const uint8_t *data, size_t size);
+
   /**
+   * Reads only header, patterns and samples are received by read of
+   * returned load. Stream is never seeked.
    * @param stream
    * @throws runtime_error
-   * @throws invalid_argument
    */
-  static void readSamplesAudioData(std::istream &stream,
-                                   std::vector<Sample> &samples, Encoding audioDataEncoding);
+  [[nodiscard]] std::unique_ptr<StreamingLoad> loadStreaming(
+      std::istream &stream) const;
+
   /**
+   * Reads only 1084 byte header, stream is left right after it.
    * @param stream
    * @throws runtime_error
    */
-  [[nodiscard]] static std::vector<int> readOrders(std::istream &stream);
+  ModInfo scan(std::istream &stream) override;
+
   /**
-   * @param stream
+   * Reads only 1084 byte header of file.
+   * @param path
    * @throws runtime_error
    */
-  [[nodiscard]] static std::string readName(std::istream &stream);
- public:
-  ~ModLoader() override = default;
+  ModInfo scan(const std::string &path) override;
 
-  std::shared_ptr<Mod> load(std::istream &stream) override;
-  std::shared_ptr<Mod> load(const std::string &path) override;
+  /**
+   * @param data At least header long.
+   * @param size
+   * @throws runtime_error
+   */
+  ModInfo scan(const uint8_t *data, size_t size);
 };
 
-}  // namespace mod
\ No newline at end of file
+}  // namespace mod
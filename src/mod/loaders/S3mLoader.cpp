@@ -0,0 +1,577 @@
+#include "S3mLoader.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#include "DataConvertors.h"
+#include "MappedFile.h"
+
+namespace mod {
+
+namespace {
+
+constexpr char tag[] = "SCRM";
+constexpr size_t tagOffset = 0x2C;
+constexpr size_t tagLength = sizeof(tag) - 1;
+constexpr size_t totalRows = 64;
+constexpr uint32_t defaultC4Speed = 8363;
+constexpr uint8_t emptyNote = 255;
+constexpr uint8_t noteCut = 254;
+constexpr int volumeEffect = 0xC;
+constexpr int speedEffect = 0xF;
+constexpr int extendedEffect = 0xE;
+
+}  // namespace
+
+#pragma region private static
+
+S3mLoader::Header S3mLoader::readHeader(ByteReader &reader) {
+  constexpr size_t nameLength = 28;
+  constexpr size_t maxOrders = 256;
+  constexpr uint16_t signedFormat = 1;
+  constexpr uint8_t disabledFlag = 0x80;
+  constexpr uint8_t firstAdlibChannel = 16;
+  constexpr uint8_t endMarker = 255;
+  constexpr uint8_t skipMarker = 254;
+  constexpr size_t minTempo = 33;
+  constexpr size_t paragraph = 16;
+
+  Header header;
+
+  header.name = reader.readString(nameLength);
+
+  // 0x1A, type and reserved.
+  reader.skip(4);
+
+  const size_t ordersCount = reader.readU16();
+  const size_t instrumentsCount = reader.readU16();
+  const size_t patternsCount = reader.readU16();
+
+  // Flags and tracker version.
+  reader.skip(4);
+
+  header.signedSamples = reader.readU16() == signedFormat;
+
+  if (std::memcmp(reader.read(tagLength), tag, tagLength) != 0) {
+    throw std::runtime_error("Not a ScreamTracker 3 module");
+  }
+
+  if (ordersCount > maxOrders || instrumentsCount > 256 ||
+      patternsCount > 256) {
+    throw std::runtime_error(
+        fmt::format("Too many orders, instruments or patterns: {}, {}, {}",
+                    ordersCount, instrumentsCount, patternsCount));
+  }
+
+  // Global volume.
+  reader.skip(1);
+
+  header.speed = reader.readU8();
+  header.tempo = reader.readU8();
+
+  if (header.speed == 0) {
+    header.speed = 6;
+  }
+
+  if (header.tempo < minTempo) {
+    header.tempo = 125;
+  }
+
+  // Master volume, ultra click removal, default pan, reserved and special.
+  reader.skip(3 + 8 + 2);
+
+  const uint8_t *settings = reader.read(maxChannels);
+
+  for (size_t i = 0; i < maxChannels; i++) {
+    if ((settings[i] & disabledFlag) == 0 && settings[i] < firstAdlibChannel) {
+      header.channelMap[i] = (int)header.channels++;
+    } else {
+      header.channelMap[i] = -1;
+    }
+  }
+
+  if (header.channels == 0) {
+    throw std::runtime_error("Module has no PCM channels");
+  }
+
+  const uint8_t *orders = reader.read(ordersCount);
+
+  for (size_t i = 0; i < ordersCount && orders[i] != endMarker; i++) {
+    if (orders[i] != skipMarker) {
+      header.orders.push_back(orders[i]);
+    }
+  }
+
+  header.songLength = header.orders.size();
+
+  for (size_t i = 0; i < instrumentsCount; i++) {
+    header.instrumentOffsets.push_back(reader.readU16() * paragraph);
+  }
+
+  for (size_t i = 0; i < patternsCount; i++) {
+    header.patternOffsets.push_back(reader.readU16() * paragraph);
+  }
+
+  return header;
+}
+
+std::vector<Sample> S3mLoader::readSamples(ByteReader &reader,
+                                           const Header &header,
+                                           std::vector<uint32_t> &c4Speeds,
+                                           bool decodeData) {
+  constexpr size_t fileNameLength = 12;
+  constexpr size_t nameLength = 28;
+  constexpr uint8_t pcmType = 1;
+  constexpr uint8_t loopFlag = 0x01;
+  constexpr uint8_t bits16Flag = 0x04;
+  constexpr size_t paragraph = 16;
+  constexpr int maxVolume = 64;
+
+  std::vector<Sample> samples;
+
+  samples.reserve(header.instrumentOffsets.size());
+  c4Speeds.reserve(header.instrumentOffsets.size());
+
+  for (const size_t offset : header.instrumentOffsets) {
+    if (offset == 0) {
+      samples.emplace_back("", 0, 0, 0, 0, 0, (float)defaultC4Speed);
+      c4Speeds.push_back(defaultC4Speed);
+      continue;
+    }
+
+    reader.seek(offset);
+
+    const uint8_t type = reader.readU8();
+
+    reader.skip(fileNameLength);
+
+    const size_t memorySegmentHigh = reader.readU8();
+    const size_t memorySegmentLow = reader.readU16();
+    size_t length = reader.readU32();
+    size_t loopStart = reader.readU32();
+    size_t loopEnd = reader.readU32();
+    const int volume = std::min<int>(reader.readU8(), maxVolume);
+
+    // Reserved.
+    reader.skip(1);
+
+    const uint8_t packing = reader.readU8();
+    const uint8_t flags = reader.readU8();
+    uint32_t c4Speed = reader.readU32();
+
+    // Reserved.
+    reader.skip(12);
+
+    std::string name = reader.readString(nameLength);
+
+    // AdLib and packed samples can not be played.
+    if (type != pcmType || packing != 0) {
+      length = 0;
+    }
+
+    if (c4Speed == 0) {
+      c4Speed = defaultC4Speed;
+    }
+
+    loopEnd = std::min(loopEnd, length);
+
+    if ((flags & loopFlag) == 0 || loopStart >= loopEnd) {
+      loopStart = 0;
+      loopEnd = 0;
+    }
+
+    // Pitch of C4 speed is applied to note periods.
+    samples.emplace_back(std::move(name), (int)length, 0, volume,
+                         (int)loopStart, (int)(loopEnd - loopStart),
+                         (float)defaultC4Speed);
+    c4Speeds.push_back(c4Speed);
+
+    if (!decodeData || length == 0) {
+      continue;
+    }
+
+    const bool bits16 = (flags & bits16Flag) != 0;
+    const size_t width = bits16 ? 2 : 1;
+    const size_t dataOffset =
+        ((memorySegmentHigh << 16) | memorySegmentLow) * paragraph;
+
+    reader.seek(dataOffset);
+
+    // Stereo samples keep left channel only. Sample cut by end of file is
+    // padded with silence.
+    const size_t available = std::min(length, reader.remaining() / width);
+    const uint8_t *data = reader.read(available * width);
+    std::vector<float> values(length, 0.0f);
+
+    if (bits16 && header.signedSamples) {
+      dataconvertors::convertFromS16(data, values.data(), available);
+    } else if (bits16) {
+      dataconvertors::convertFromU16(data, values.data(), available);
+    } else if (header.signedSamples) {
+      dataconvertors::convertFromS8(data, values.data(), available);
+    } else {
+      dataconvertors::convertFromU8(data, values.data(), available);
+    }
+
+    samples.back().setData(std::move(values));
+  }
+
+  return samples;
+}
+
+int S3mLoader::noteToPeriod(uint8_t note, uint32_t c4Speed) {
+  // Octave 0 periods in ScreamTracker units, 4 times Amiga ones.
+  static constexpr std::array<int, 12> periods = {
+      1712, 1616, 1524, 1440, 1356, 1280, 1208, 1140, 1076, 1016, 960, 907};
+
+  const size_t octave = note >> 4;
+  const size_t semitone = note & 0xF;
+
+  if (semitone >= periods.size()) {
+    return 0;
+  }
+
+  const double period = (double)defaultC4Speed * 4.0 * periods[semitone] /
+                        ((double)c4Speed * (double)(1 << octave));
+
+  return std::max(1, (int)std::lround(period));
+}
+
+void S3mLoader::convertEffect(Note &note, uint8_t command, uint8_t info) {
+  const int high = info >> 4;
+  const int low = info & 0xF;
+
+  note.effectNumber = 0;
+  note.effectParameter = info;
+
+  switch (command) {
+    // Axx, set speed.
+    case 1:
+      if (info != 0 && info < 0x20) {
+        note.effectNumber = speedEffect;
+      } else {
+        note.effectParameter = 0;
+      }
+      break;
+    // Bxx, position jump.
+    case 2:
+      note.effectNumber = 0xB;
+      break;
+    // Cxx, pattern break.
+    case 3:
+      note.effectNumber = 0xD;
+      break;
+    // Dxy, volume slide and fine volume slides.
+    case 4:
+      if (low == 0xF && high != 0) {
+        note.effectNumber = extendedEffect;
+        note.effectParameter = 0xA0 | high;
+      } else if (high == 0xF && low != 0) {
+        note.effectNumber = extendedEffect;
+        note.effectParameter = 0xB0 | low;
+      } else if (high == 0 || low == 0) {
+        note.effectNumber = 0xA;
+      } else {
+        note.effectParameter = 0;
+      }
+      break;
+    // Exx and Fxx, portamento down and up. Extra fine slides are dropped.
+    case 5:
+    case 6:
+      if (high == 0xF) {
+        note.effectNumber = extendedEffect;
+        note.effectParameter = (command == 5 ? 0x20 : 0x10) | low;
+      } else if (high == 0xE) {
+        note.effectParameter = 0;
+      } else {
+        note.effectNumber = command == 5 ? 0x2 : 0x1;
+      }
+      break;
+    // Gxx, tone portamento.
+    case 7:
+      note.effectNumber = 0x3;
+      break;
+    // Hxy, vibrato.
+    case 8:
+      note.effectNumber = 0x4;
+      break;
+    // Jxy, arpeggio.
+    case 10:
+      note.effectNumber = 0x0;
+      break;
+    // Kxy, vibrato and volume slide.
+    case 11:
+      note.effectNumber = 0x6;
+      break;
+    // Lxy, tone portamento and volume slide.
+    case 12:
+      note.effectNumber = 0x5;
+      break;
+    // Oxx, sample offset.
+    case 15:
+      note.effectNumber = 0x9;
+      break;
+    // Qxy, retrigger.
+    case 17:
+      note.effectNumber = extendedEffect;
+      note.effectParameter = 0x90 | low;
+      break;
+    // Rxy, tremolo.
+    case 18:
+      note.effectNumber = 0x7;
+      break;
+    // Sxy, special commands with extended mod equivalent.
+    case 19: {
+      static constexpr std::array<int, 16> extended = {
+          -1, 0x3, 0x5, 0x4, 0x7, -1, -1, -1,
+          0x8, -1, -1, 0x6, 0xC, 0xD, 0xE, -1};
+
+      if (extended[high] >= 0) {
+        note.effectNumber = extendedEffect;
+        note.effectParameter = (extended[high] << 4) | low;
+      } else {
+        note.effectParameter = 0;
+      }
+      break;
+    }
+    // Tempo, tremor, global volume and the rest are not supported.
+    default:
+      note.effectParameter = 0;
+      break;
+  }
+}
+
+Pattern S3mLoader::decodePattern(ByteReader &reader, size_t offset,
+                                 const Header &header,
+                                 const std::vector<uint32_t> &c4Speeds,
+                                 std::vector<int> &lastInstruments) {
+  constexpr uint8_t channelMask = 0x1F;
+  constexpr uint8_t noteFlag = 0x20;
+  constexpr uint8_t volumeFlag = 0x40;
+  constexpr uint8_t commandFlag = 0x80;
+  constexpr uint8_t maxVolume = 64;
+
+  Pattern pattern(header.channels, totalRows);
+
+  for (size_t i = 0; i < totalRows; i++) {
+    pattern.addRow(Row(std::vector<Note>(header.channels, Note{0, 0, 0, 0})));
+  }
+
+  if (offset == 0) {
+    return pattern;
+  }
+
+  reader.seek(offset);
+
+  // Packed length, rows are terminated by zero bytes instead.
+  reader.skip(2);
+
+  ByteReader packed(reader.data() + reader.tell(), reader.remaining());
+  std::vector<Row> &rows = pattern.getRows();
+
+  for (size_t row = 0; row < totalRows && packed.remaining() > 0;) {
+    const uint8_t what = packed.readU8();
+
+    if (what == 0) {
+      row++;
+      continue;
+    }
+
+    const size_t entrySize = ((what & noteFlag) != 0 ? 2 : 0) +
+                             ((what & volumeFlag) != 0 ? 1 : 0) +
+                             ((what & commandFlag) != 0 ? 2 : 0);
+
+    if (packed.remaining() < entrySize) {
+      break;
+    }
+
+    uint8_t note = emptyNote;
+    uint8_t instrument = 0;
+    int volume = -1;
+    uint8_t command = 0;
+    uint8_t info = 0;
+
+    if ((what & noteFlag) != 0) {
+      note = packed.readU8();
+      instrument = packed.readU8();
+    }
+
+    if ((what & volumeFlag) != 0) {
+      volume = std::min(packed.readU8(), maxVolume);
+    }
+
+    if ((what & commandFlag) != 0) {
+      command = packed.readU8();
+      info = packed.readU8();
+    }
+
+    const int channel = header.channelMap[what & channelMask];
+
+    if (channel < 0) {
+      continue;
+    }
+
+    Note &out = rows[row].getNote((size_t)channel);
+
+    if (instrument != 0) {
+      lastInstruments[channel] = instrument;
+    }
+
+    const int sampleIndex = lastInstruments[channel];
+
+    if (note < noteCut && sampleIndex >= 1 &&
+        (size_t)sampleIndex <= c4Speeds.size()) {
+      const int period = S3mLoader::noteToPeriod(note, c4Speeds[sampleIndex - 1]);
+
+      if (period != 0) {
+        out.sampleIndex = sampleIndex;
+        out.samplePeriodFrequency = period;
+      }
+    }
+
+    S3mLoader::convertEffect(out, command, info);
+
+    const bool effectFree = out.effectNumber == 0 && out.effectParameter == 0;
+
+    if (effectFree && volume >= 0) {
+      out.effectNumber = volumeEffect;
+      out.effectParameter = volume;
+    } else if (effectFree && note == noteCut) {
+      out.effectNumber = volumeEffect;
+      out.effectParameter = 0;
+    }
+  }
+
+  return pattern;
+}
+
+std::shared_ptr<Mod> S3mLoader::parse(const uint8_t *data, size_t size) {
+  constexpr size_t defaultSpeed = 6;
+
+  ByteReader reader(data, size);
+  Header header = S3mLoader::readHeader(reader);
+
+  std::vector<uint32_t> c4Speeds;
+  std::vector<Sample> samples =
+      S3mLoader::readSamples(reader, header, c4Speeds, true);
+
+  std::vector<int> lastInstruments(header.channels, 0);
+  std::vector<Pattern> patterns;
+
+  patterns.reserve(header.patternOffsets.size());
+
+  for (const size_t offset : header.patternOffsets) {
+    patterns.push_back(S3mLoader::decodePattern(reader, offset, header,
+                                                c4Speeds, lastInstruments));
+  }
+
+  // Missing patterns play empty.
+  for (const int order : header.orders) {
+    while ((size_t)order >= patterns.size()) {
+      patterns.push_back(S3mLoader::decodePattern(reader, 0, header, c4Speeds,
+                                                  lastInstruments));
+    }
+  }
+
+  // Generator starts at default speed, initial speed is set on first row.
+  if (header.speed != defaultSpeed && header.songLength > 0) {
+    Row &row = patterns[header.orders[0]].getRow(0);
+
+    for (size_t channel = 0; channel < header.channels; channel++) {
+      Note &note = row.getNote(channel);
+
+      if (note.effectNumber == 0 && note.effectParameter == 0) {
+        note.effectNumber = speedEffect;
+        note.effectParameter = (int)std::min<size_t>(header.speed, 0x1F);
+        break;
+      }
+    }
+  }
+
+  return std::make_shared<Mod>(header.name, header.songLength,
+                               std::move(samples), std::move(patterns),
+                               std::move(header.orders));
+}
+
+ModInfo S3mLoader::scanData(const uint8_t *data, size_t size) {
+  ByteReader reader(data, size);
+  const Header header = S3mLoader::readHeader(reader);
+
+  std::vector<uint32_t> c4Speeds;
+  const std::vector<Sample> samples =
+      S3mLoader::readSamples(reader, header, c4Speeds, false);
+
+  ModInfo info;
+
+  info.name = header.name;
+  info.channels = header.channels;
+  info.songLength = header.songLength;
+  info.patternCount = header.patternOffsets.size();
+
+  for (const auto &sample : samples) {
+    info.sampleNames.push_back(sample.getName());
+  }
+
+  // Row lasts speed ticks of 2.5 / tempo seconds.
+  info.estimatedDuration = (float)(header.songLength * totalRows) *
+                           (float)header.speed * 2.5f / (float)header.tempo;
+
+  return info;
+}
+
+#pragma endregion
+
+int S3mLoader::probe(const uint8_t *header, size_t size) const {
+  if (size >= tagOffset + tagLength &&
+      std::memcmp(header + tagOffset, tag, tagLength) == 0) {
+    return 100;
+  }
+
+  return 0;
+}
+
+size_t S3mLoader::getProbeSize() const { return tagOffset + tagLength; }
+
+std::shared_ptr<Mod> S3mLoader::load(std::istream &stream) {
+  if (!stream) {
+    throw std::runtime_error("S3m reading error: stream bad");
+  }
+
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)),
+                            std::istreambuf_iterator<char>());
+
+  return S3mLoader::parse(data.data(), data.size());
+}
+
+std::shared_ptr<Mod> S3mLoader::load(const std::string &path) {
+  const MappedFile file(path);
+
+  return S3mLoader::parse(file.data(), file.size());
+}
+
+std::shared_ptr<Mod> S3mLoader::load(const uint8_t *data, size_t size) {
+  return S3mLoader::parse(data, size);
+}
+
+ModInfo S3mLoader::scan(std::istream &stream) {
+  if (!stream) {
+    throw std::runtime_error("S3m reading error: stream bad");
+  }
+
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)),
+                            std::istreambuf_iterator<char>());
+
+  return S3mLoader::scanData(data.data(), data.size());
+}
+
+ModInfo S3mLoader::scan(const std::string &path) {
+  const MappedFile file(path);
+
+  return S3mLoader::scanData(file.data(), file.size());
+}
+
+}  // namespace mod
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <vector>
+
+#include "ByteReader.h"
+#include "TrackerLoader.h"
+#include "mod/Mod.h"
+
+namespace mod {
+
+/**
+ * ScreamTracker 3 module loader. Enabled PCM channels, up to 32, are packed
+ * into mod channels in file order. Notes are converted to Amiga periods
+ * using C4 speed of their sample and effects to their mod equivalents.
+ * AdLib channels and instruments, panning, tremor and global volume are not
+ * supported by generator and are skipped.
+ */
+class S3mLoader : public TrackerLoader {
+ private:
+  static constexpr size_t maxChannels = 32;
+
+  struct Header {
+    std::string name;
+    // Orders with markers removed, song ends at first end marker.
+    std::vector<int> orders;
+    size_t songLength = 0;
+    // Mod channel of each S3M channel, -1 for skipped channel.
+    std::array<int, maxChannels> channelMap{};
+    size_t channels = 0;
+    std::vector<size_t> instrumentOffsets;
+    std::vector<size_t> patternOffsets;
+    bool signedSamples = false;
+    size_t speed = 6;
+    size_t tempo = 125;
+  };
+
+  /**
+   * @param reader
+   * @throws runtime_error
+   */
+  static Header readHeader(ByteReader &reader);
+
+  /**
+   * @param reader
+   * @param header
+   * @param c4Speeds C4 speed of each sample.
+   * @param decodeData If false, sample data is skipped.
+   * @throws runtime_error
+   */
+  static std::vector<Sample> readSamples(ByteReader &reader,
+                                         const Header &header,
+                                         std::vector<uint32_t> &c4Speeds,
+                                         bool decodeData);
+
+  /**
+   * @param note Octave in high nibble, semitone in low one.
+   * @param c4Speed
+   * @return Amiga period, 0 for invalid note.
+   */
+  static int noteToPeriod(uint8_t note, uint32_t c4Speed);
+
+  /**
+   * Converts S3M command to mod effect in place. Commands without mod
+   * equivalent are cleared.
+   * @param note
+   * @param command
+   * @param info
+   */
+  static void convertEffect(Note &note, uint8_t command, uint8_t info);
+
+  /**
+   * Unpacks channel and mask bytes in one pass straight into notes of
+   * empty 64 row pattern. Truncated data leaves rest of pattern empty.
+   * @param reader
+   * @param offset 0 for empty pattern.
+   * @param header
+   * @param c4Speeds
+   * @param lastInstruments Instrument of each channel, used by notes
+   * without one. Carried between patterns in file order.
+   * @throws runtime_error
+   */
+  static Pattern decodePattern(ByteReader &reader, size_t offset,
+                               const Header &header,
+                               const std::vector<uint32_t> &c4Speeds,
+                               std::vector<int> &lastInstruments);
+
+  /**
+   * @param data Whole module.
+   * @param size
+   * @throws runtime_error
+   */
+  static std::shared_ptr<Mod> parse(const uint8_t *data, size_t size);
+
+  /**
+   * @param data Whole module.
+   * @param size
+   * @throws runtime_error
+   */
+  static ModInfo scanData(const uint8_t *data, size_t size);
+
+ public:
+  ~S3mLoader() override = default;
+
+  /**
+   * Checks "SCRM" tag at offset 44.
+   * @param header
+   * @param size
+   * @return 100 for S3M, 0 otherwise.
+   */
+  [[nodiscard]] int probe(const uint8_t *header, size_t size) const override;
+
+  [[nodiscard]] size_t getProbeSize() const override;
+
+  /**
+   * @param stream
+   * @throws runtime_error
+   */
+  std::shared_ptr<Mod> load(std::istream &stream) override;
+
+  /**
+   * @param path
+   * @throws runtime_error
+   */
+  std::shared_ptr<Mod> load(const std::string &path) override;
+
+  /**
+   * @param data Whole module. Not referenced after return.
+   * @param size
+   * @throws runtime_error
+   */
+  std::shared_ptr<Mod> load(const uint8_t *data, size_t size);
+
+  /**
+   * Reads header and sample headers only. Duration is exact for initial
+   * speed and tempo without speed effects.
+   * @param stream
+   * @throws runtime_error
+   */
+  ModInfo scan(std::istream &stream) override;
+
+  /**
+   * @param path
+   * @throws runtime_error
+   */
+  ModInfo scan(const std::string &path) override;
+};
+
+}  // namespace mod
@@ -0,0 +1,249 @@
+#include "StreamingLoad.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+
+#include "ByteReader.h"
+#include "ModLoader.h"
+
+namespace mod {
+
+struct StreamingLoad::Buffer {
+  // Left uninitialized, so pages are committed only as read writes them.
+  std::unique_ptr<uint8_t[]> data;
+  size_t size = 0;
+  // Bytes of data written by read, published with release.
+  std::atomic<size_t> received = 0;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool failed = false;
+
+  /**
+   * @param end
+   * @throws runtime_error If stream ended before end.
+   */
+  void waitFor(size_t end) {
+    if (this->received.load(std::memory_order_acquire) >= end) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    this->condition.wait(lock, [this, end]() {
+      return this->received.load(std::memory_order_acquire) >= end ||
+             this->failed;
+    });
+
+    if (this->received.load(std::memory_order_acquire) < end) {
+      throw std::runtime_error("Mod stream ended before data was received");
+    }
+  }
+};
+
+class StreamingLoad::Decoder : public LazyDecoder {
+ private:
+  static constexpr size_t totalRows = 64;
+  static constexpr size_t noteDataSize = 4;
+
+  std::shared_ptr<Buffer> _buffer;
+  size_t _channels;
+  std::vector<size_t> _sampleEnds;
+  std::vector<size_t> _sampleLengths;
+  std::shared_ptr<SampleStore> _sampleStore;
+
+  [[nodiscard]] size_t patternSize() const {
+    return this->_channels * totalRows * noteDataSize;
+  }
+
+ public:
+  Decoder(std::shared_ptr<Buffer> buffer, size_t channels,
+          std::vector<size_t> sampleEnds, std::vector<size_t> sampleLengths,
+          std::shared_ptr<SampleStore> sampleStore)
+      : _buffer(std::move(buffer)),
+        _channels(channels),
+        _sampleEnds(std::move(sampleEnds)),
+        _sampleLengths(std::move(sampleLengths)),
+        _sampleStore(std::move(sampleStore)) {}
+
+  [[nodiscard]] Pattern decodePattern(size_t index) const override {
+    const size_t end = (index + 1) * this->patternSize();
+
+    this->_buffer->waitFor(end);
+
+    ByteReader reader(this->_buffer->data.get() + end - this->patternSize(),
+                      this->patternSize());
+
+    return ModLoader::serializePattern(reader, this->_channels, totalRows);
+  }
+
+  void decodeSample(size_t index, Sample &sample) const override {
+    const size_t end = this->_sampleEnds[index];
+
+    this->_buffer->waitFor(end);
+
+    ModLoader::decodeSampleData(
+        this->_buffer->data.get() + end - this->_sampleLengths[index], sample,
+        Encoding::Signed8, this->_sampleStore.get());
+  }
+
+  [[nodiscard]] bool isPatternAvailable(size_t index) const override {
+    return this->_buffer->received.load(std::memory_order_acquire) >=
+           (index + 1) * this->patternSize();
+  }
+
+  [[nodiscard]] bool isSampleAvailable(size_t index) const override {
+    return this->_buffer->received.load(std::memory_order_acquire) >=
+           this->_sampleEnds[index];
+  }
+};
+
+#pragma region public constructor
+
+StreamingLoad::StreamingLoad(std::istream &stream,
+                             std::shared_ptr<SampleStore> sampleStore)
+    : _stream(stream), _buffer(std::make_shared<Buffer>()) {
+  constexpr size_t headerSize = 1084;
+  constexpr size_t totalRows = 64;
+  constexpr size_t noteDataSize = 4;
+
+  std::array<uint8_t, headerSize> header{};
+
+  if (!stream.read(reinterpret_cast<char *>(header.data()), header.size())) {
+    throw std::runtime_error("Mod stream ended before header");
+  }
+
+  ByteReader reader(header.data(), header.size());
+
+  std::string name = ModLoader::readName(reader);
+  std::vector<Sample> samples = ModLoader::readSamples(reader);
+
+  const size_t songLength = reader.readU8();
+
+  // Restart position, unused.
+  reader.skip(1);
+
+  std::vector<int> orders = ModLoader::readOrders(reader);
+  const size_t channels = ModLoader::getChannels(header.data(), header.size());
+  const size_t patternsCount = ModLoader::countPatterns(orders);
+
+  this->_patternsEnd = patternsCount * channels * totalRows * noteDataSize;
+
+  std::vector<size_t> sampleLengths;
+  size_t end = this->_patternsEnd;
+
+  for (const auto &sample : samples) {
+    const size_t length =
+        sample.getLength() * bytesInEncoding(Encoding::Signed8);
+
+    end += length;
+    sampleLengths.push_back(length);
+    this->_sampleEnds.push_back(end);
+  }
+
+  this->_buffer->data.reset(new uint8_t[end]);
+  this->_buffer->size = end;
+  this->_progress.bytesExpected = end;
+
+  auto decoder = std::make_shared<const Decoder>(
+      this->_buffer, channels, this->_sampleEnds, std::move(sampleLengths),
+      std::move(sampleStore));
+
+  this->_mod = std::make_shared<Mod>(std::move(name), songLength, channels,
+                                     std::move(samples), patternsCount,
+                                     std::move(orders), std::move(decoder));
+}
+
+StreamingLoad::~StreamingLoad() {
+  std::lock_guard<std::mutex> lock(this->_buffer->mutex);
+
+  // Mod may outlive load, parts which were not received never will be.
+  this->_buffer->failed = true;
+  this->_buffer->condition.notify_all();
+}
+
+#pragma endregion
+
+#pragma region public
+
+std::shared_ptr<Mod> StreamingLoad::getMod() const { return this->_mod; }
+
+bool StreamingLoad::read(size_t size) {
+  Buffer &buffer = *this->_buffer;
+  const size_t received = buffer.received.load(std::memory_order_relaxed);
+  const size_t count = std::min(size, buffer.size - received);
+
+  if (count == 0) {
+    return false;
+  }
+
+  this->_stream.read(reinterpret_cast<char *>(buffer.data.get() + received),
+                     (std::streamsize)count);
+
+  const auto got = (size_t)this->_stream.gcount();
+
+  {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+
+    buffer.received.store(received + got, std::memory_order_release);
+    buffer.failed = got < count;
+  }
+
+  buffer.condition.notify_all();
+
+  if (got < count) {
+    throw std::runtime_error(
+        fmt::format("Mod stream ended after {} of {} bytes", received + got,
+                    buffer.size));
+  }
+
+  LoadProgress progress = this->_progress;
+
+  progress.bytesReceived = received + got;
+  progress.patternsAvailable = progress.bytesReceived >= this->_patternsEnd;
+
+  while (progress.samplesAvailable < this->_sampleEnds.size() &&
+         this->_sampleEnds[progress.samplesAvailable] <=
+             progress.bytesReceived) {
+    progress.samplesAvailable++;
+  }
+
+  const bool changed =
+      progress.patternsAvailable != this->_progress.patternsAvailable ||
+      progress.samplesAvailable != this->_progress.samplesAvailable;
+
+  this->_progress = progress;
+
+  if (changed && this->_progressCallback != nullptr) {
+    this->_progressCallback(this->_progress);
+  }
+
+  return !this->isComplete();
+}
+
+void StreamingLoad::readAll() {
+  while (this->read()) {
+  }
+}
+
+const LoadProgress &StreamingLoad::getProgress() const {
+  return this->_progress;
+}
+
+bool StreamingLoad::isComplete() const {
+  return this->_progress.bytesReceived == this->_progress.bytesExpected;
+}
+
+void StreamingLoad::setProgressCallback(
+    std::function<void(const LoadProgress &)> callback) {
+  this->_progressCallback = std::move(callback);
+}
+
+#pragma endregion
+
+}  // namespace mod
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <memory>
+
+#include "mod/Mod.h"
+#include "mod/SampleStore.h"
+
+namespace mod {
+
+struct LoadProgress {
+  size_t bytesReceived = 0;
+  size_t bytesExpected = 0;
+  bool patternsAvailable = false;
+  // Samples are stored in order, so first samplesAvailable are received.
+  size_t samplesAvailable = 0;
+};
+
+/**
+ * Forward only mod loading from non-seekable stream, e.g. pipe or socket.
+ * Mod is created from header right away, patterns and samples become
+ * available as read receives them. Generator plays silence while data of
+ * current order is missing, so read may run on other thread during playback.
+ * Buffer for whole module is allocated from sizes in header, but its memory
+ * is only committed as read receives data into it.
+ */
+class StreamingLoad {
+ private:
+  struct Buffer;
+  class Decoder;
+
+  std::istream &_stream;
+  std::shared_ptr<Buffer> _buffer;
+  std::shared_ptr<Mod> _mod;
+  std::vector<size_t> _sampleEnds;
+  size_t _patternsEnd = 0;
+  LoadProgress _progress;
+  std::function<void(const LoadProgress &)> _progressCallback = nullptr;
+
+ public:
+  /**
+   * Reads 1084 byte header.
+   * @param stream Read from calling thread of read.
+   * @param sampleStore If not nullptr, decoded sample data is interned in it.
+   * @throws runtime_error
+   */
+  StreamingLoad(std::istream &stream, std::shared_ptr<SampleStore> sampleStore);
+
+  ~StreamingLoad();
+
+  StreamingLoad(const StreamingLoad &) = delete;
+  StreamingLoad &operator=(const StreamingLoad &) = delete;
+
+  /**
+   * Mod is lazily decoded. Access to part which was not received yet waits
+   * for it, or throws runtime_error if stream ended before it.
+   */
+  [[nodiscard]] std::shared_ptr<Mod> getMod() const;
+
+  /**
+   * Receives up to size bytes.
+   * @param size
+   * @return false if all data was received.
+   * @throws runtime_error If stream ended before all data was received.
+   */
+  bool read(size_t size = 64 * 1024);
+
+  /**
+   * @throws runtime_error If stream ended before all data was received.
+   */
+  void readAll();
+
+  [[nodiscard]] const LoadProgress &getProgress() const;
+
+  [[nodiscard]] bool isComplete() const;
+
+  /**
+   * @param callback Called by read when patterns or a sample become
+   * available. If nullptr, then callback would not be called.
+   */
+  void setProgressCallback(
+      std::function<void(const LoadProgress &)> callback);
+};
+
+}  // namespace mod
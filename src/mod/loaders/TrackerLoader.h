@@ -1,9 +1,13 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <istream>
 #include <memory>
+#include <string>
 
 #include "mod/Mod.h"
+#include "mod/ModInfo.h"
 
 namespace mod {
 
@@ -11,8 +15,30 @@ class TrackerLoader {
  public:
   virtual ~TrackerLoader() = default;
 
+  /**
+   * Cheap check of header, does not throw.
+   * @param header Start of file, getProbeSize() bytes or less if file is
+   * shorter.
+   * @param size
+   * @return Confidence from 0, not this format, to 100.
+   */
+  [[nodiscard]] virtual int probe(const uint8_t *header, size_t size) const = 0;
+
+  /**
+   * @return Bytes of header probe needs.
+   */
+  [[nodiscard]] virtual size_t getProbeSize() const = 0;
+
   virtual std::shared_ptr<Mod> load(std::istream &stream) = 0;
   virtual std::shared_ptr<Mod> load(const std::string &path) = 0;
+
+  /**
+   * Reads metadata from header, without decoding the rest.
+   * @param stream
+   * @throws runtime_error
+   */
+  virtual ModInfo scan(std::istream &stream) = 0;
+  virtual ModInfo scan(const std::string &path) = 0;
 };
 
 }  // namespace mod
@@ -0,0 +1,496 @@
+#include "XmLoader.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#include "DataConvertors.h"
+#include "MappedFile.h"
+
+namespace mod {
+
+namespace {
+
+constexpr char idText[] = "Extended Module: ";
+constexpr size_t idLength = sizeof(idText) - 1;
+constexpr size_t totalNotes = 96;
+constexpr uint8_t keyOff = 97;
+constexpr int volumeEffect = 0xC;
+constexpr int speedEffect = 0xF;
+
+}  // namespace
+
+#pragma region private static
+
+XmLoader::Header XmLoader::readHeader(ByteReader &reader) {
+  constexpr size_t nameLength = 20;
+  constexpr size_t trackerNameLength = 20;
+  constexpr size_t totalOrders = 256;
+  constexpr uint16_t minimalVersion = 0x0104;
+
+  if (std::memcmp(reader.read(idLength), idText, idLength) != 0) {
+    throw std::runtime_error("Not an extended module");
+  }
+
+  Header header;
+
+  header.name = reader.readString(nameLength);
+
+  // 0x1A and tracker name.
+  reader.skip(1 + trackerNameLength);
+
+  const uint16_t version = reader.readU16();
+
+  if (version < minimalVersion) {
+    throw std::runtime_error(
+        fmt::format("Unsupported extended module version {:#06x}", version));
+  }
+
+  const size_t headerStart = reader.tell();
+  const size_t headerSize = reader.readU32();
+
+  header.songLength = std::min<size_t>(reader.readU16(), totalOrders);
+
+  // Restart position, unused.
+  reader.skip(2);
+
+  header.channels = reader.readU16();
+  header.patternsCount = reader.readU16();
+  header.instrumentsCount = reader.readU16();
+
+  // Flags, frequency table does not change pitch of notes.
+  reader.skip(2);
+
+  header.tempo = reader.readU16();
+  header.bpm = reader.readU16();
+
+  const uint8_t *orders = reader.read(totalOrders);
+
+  header.orders.assign(orders, orders + totalOrders);
+  header.patternsOffset = headerStart + headerSize;
+
+  if (header.channels == 0 || header.channels > 64) {
+    throw std::runtime_error(
+        fmt::format("Unsupported channel count: {}", header.channels));
+  }
+
+  if (header.patternsCount > 256 || header.instrumentsCount > 128) {
+    throw std::runtime_error(
+        fmt::format("Too many patterns or instruments: {}, {}",
+                    header.patternsCount, header.instrumentsCount));
+  }
+
+  return header;
+}
+
+std::vector<XmLoader::PatternBlock> XmLoader::readPatternBlocks(
+    ByteReader &reader, size_t count) {
+  constexpr size_t defaultRows = 64;
+
+  std::vector<PatternBlock> blocks(count);
+
+  for (auto &block : blocks) {
+    const size_t start = reader.tell();
+    const size_t headerLength = reader.readU32();
+
+    // Packing type, always 0.
+    reader.skip(1);
+
+    block.rows = reader.readU16();
+
+    if (block.rows == 0) {
+      block.rows = defaultRows;
+    }
+
+    block.size = reader.readU16();
+
+    reader.seek(start + headerLength);
+
+    if (block.size != 0) {
+      block.data = reader.read(block.size);
+    }
+  }
+
+  return blocks;
+}
+
+void XmLoader::readInstruments(ByteReader &reader, size_t count,
+                               std::vector<Instrument> &instruments,
+                               std::vector<Sample> &samples,
+                               std::vector<SampleTuning> &tunings,
+                               bool decodeData) {
+  constexpr size_t nameLength = 22;
+  constexpr size_t maxSamples = 16;
+  constexpr uint8_t loopTypeMask = 0x3;
+  constexpr uint8_t bits16Flag = 0x10;
+  constexpr int maxVolume = 64;
+  constexpr size_t minSampleHeaderSize = 40;
+
+  for (size_t i = 0; i < count; i++) {
+    const size_t start = reader.tell();
+    const size_t size = reader.readU32();
+
+    // Name and type.
+    reader.skip(nameLength + 1);
+
+    Instrument instrument;
+
+    instrument.firstSample = samples.size();
+    instrument.samplesCount = reader.readU16();
+
+    if (instrument.samplesCount > maxSamples) {
+      throw std::runtime_error(
+          fmt::format("Instrument {} has {} samples", i + 1,
+                      instrument.samplesCount));
+    }
+
+    size_t sampleHeaderSize = 0;
+
+    if (instrument.samplesCount > 0) {
+      // Some writers store 0, header is never shorter than its fields.
+      sampleHeaderSize =
+          std::max<size_t>(reader.readU32(), minSampleHeaderSize);
+      std::memcpy(instrument.keymap.data(), reader.read(totalNotes),
+                  totalNotes);
+    }
+
+    reader.seek(start + size);
+
+    // Data size in bytes and bit depth of each sample.
+    std::vector<std::pair<size_t, bool>> formats;
+
+    for (size_t j = 0; j < instrument.samplesCount; j++) {
+      const size_t headerStart = reader.tell();
+
+      size_t length = reader.readU32();
+      size_t loopStart = reader.readU32();
+      size_t loopLength = reader.readU32();
+      const int volume = std::min<int>(reader.readU8(), maxVolume);
+      const auto finetune = (int8_t)reader.readU8();
+      const uint8_t type = reader.readU8();
+
+      // Panning.
+      reader.skip(1);
+
+      const auto relativeNote = (int8_t)reader.readU8();
+
+      // Reserved.
+      reader.skip(1);
+
+      std::string name = reader.readString(nameLength);
+
+      reader.seek(headerStart + sampleHeaderSize);
+
+      const bool bits16 = (type & bits16Flag) != 0;
+
+      formats.emplace_back(length, bits16);
+
+      if (bits16) {
+        length /= 2;
+        loopStart /= 2;
+        loopLength /= 2;
+      }
+
+      if ((type & loopTypeMask) == 0 || loopStart >= length) {
+        loopStart = 0;
+        loopLength = 0;
+      }
+
+      loopLength = std::min(loopLength, length - loopStart);
+
+      // Mod finetune is in 1/8 semitones, xm in 1/128. Pitch is applied to
+      // periods of notes instead.
+      samples.emplace_back(std::move(name), (int)length, finetune / 16, volume,
+                           (int)loopStart, (int)loopLength, 8363.0f);
+      tunings.push_back({relativeNote, finetune});
+    }
+
+    for (size_t j = 0; j < formats.size(); j++) {
+      const auto [bytes, bits16] = formats[j];
+      Sample &sample = samples[instrument.firstSample + j];
+
+      if (!decodeData) {
+        reader.skip(bytes);
+        continue;
+      }
+
+      const uint8_t *data = reader.read(bytes);
+      std::vector<float> values(sample.getLength());
+
+      if (bits16) {
+        dataconvertors::decodeDeltaS16(data, values.data(), values.size());
+      } else {
+        dataconvertors::decodeDeltaS8(data, values.data(), values.size());
+      }
+
+      sample.setData(std::move(values));
+    }
+
+    instruments.push_back(instrument);
+  }
+}
+
+int XmLoader::noteToPeriod(int note, const SampleTuning &tuning) {
+  // C-4 plays sample at 8363 Hz, which is Amiga period 428.
+  constexpr double middlePeriod = 428.0;
+  constexpr double middleNote = 48.0;
+
+  const double realNote = (double)(note - 1 + tuning.relativeNote) +
+                          (double)tuning.finetune / 128.0;
+  const double period =
+      middlePeriod * std::pow(2.0, (middleNote - realNote) / 12.0);
+
+  return std::max(1, (int)std::lround(period));
+}
+
+Pattern XmLoader::decodePattern(const PatternBlock &block, size_t channels,
+                                const std::vector<Instrument> &instruments,
+                                const std::vector<SampleTuning> &tunings,
+                                std::vector<size_t> &lastInstruments) {
+  constexpr uint8_t packedFlag = 0x80;
+  constexpr uint8_t minVolume = 0x10;
+  constexpr uint8_t maxVolume = 0x50;
+  constexpr int minBpm = 0x20;
+
+  ByteReader reader(block.data, block.size);
+  Pattern pattern(channels, block.rows);
+
+  for (size_t row = 0; row < block.rows; row++) {
+    std::vector<Note> notes(channels, Note{0, 0, 0, 0});
+
+    // Truncated pattern data leaves rest of pattern empty.
+    for (size_t channel = 0; channel < channels && reader.remaining() > 0;
+         channel++) {
+      uint8_t note = 0;
+      uint8_t instrument = 0;
+      uint8_t volume = 0;
+      uint8_t effect = 0;
+      uint8_t parameter = 0;
+
+      const uint8_t first = reader.readU8();
+
+      if ((first & packedFlag) != 0) {
+        note = (first & 0x01) != 0 ? reader.readU8() : 0;
+        instrument = (first & 0x02) != 0 ? reader.readU8() : 0;
+        volume = (first & 0x04) != 0 ? reader.readU8() : 0;
+        effect = (first & 0x08) != 0 ? reader.readU8() : 0;
+        parameter = (first & 0x10) != 0 ? reader.readU8() : 0;
+      } else {
+        note = first;
+        instrument = reader.readU8();
+        volume = reader.readU8();
+        effect = reader.readU8();
+        parameter = reader.readU8();
+      }
+
+      Note &out = notes[channel];
+
+      if (instrument != 0) {
+        lastInstruments[channel] = instrument;
+      }
+
+      const size_t instrumentIndex = lastInstruments[channel];
+
+      if (note >= 1 && note <= totalNotes && instrumentIndex >= 1 &&
+          instrumentIndex <= instruments.size()) {
+        const Instrument &mapped = instruments[instrumentIndex - 1];
+        const size_t sample = mapped.keymap[note - 1];
+
+        if (sample < mapped.samplesCount) {
+          const size_t sampleIndex = mapped.firstSample + sample;
+
+          out.sampleIndex = (int)sampleIndex + 1;
+          out.samplePeriodFrequency =
+              XmLoader::noteToPeriod(note, tunings[sampleIndex]);
+        }
+      }
+
+      // Speed above 0x1F is BPM, which generator does not support. F00
+      // stops song in FastTracker and would give rows zero length here.
+      if (effect != speedEffect || (parameter != 0 && parameter < minBpm)) {
+        out.effectNumber = effect;
+        out.effectParameter = parameter;
+      }
+
+      const bool effectFree = out.effectNumber == 0 && out.effectParameter == 0;
+
+      if (effectFree && volume >= minVolume && volume <= maxVolume) {
+        out.effectNumber = volumeEffect;
+        out.effectParameter = volume - minVolume;
+      } else if (effectFree && note == keyOff) {
+        out.effectNumber = volumeEffect;
+        out.effectParameter = 0;
+      }
+    }
+
+    pattern.addRow(Row(std::move(notes)));
+  }
+
+  return pattern;
+}
+
+std::shared_ptr<Mod> XmLoader::parse(const uint8_t *data, size_t size) {
+  constexpr size_t defaultTempo = 6;
+
+  ByteReader reader(data, size);
+  Header header = XmLoader::readHeader(reader);
+
+  reader.seek(header.patternsOffset);
+
+  const std::vector<PatternBlock> blocks =
+      XmLoader::readPatternBlocks(reader, header.patternsCount);
+
+  std::vector<Instrument> instruments;
+  std::vector<Sample> samples;
+  std::vector<SampleTuning> tunings;
+
+  XmLoader::readInstruments(reader, header.instrumentsCount, instruments,
+                            samples, tunings, true);
+
+  std::vector<size_t> lastInstruments(header.channels, 0);
+  std::vector<Pattern> patterns;
+
+  patterns.reserve(blocks.size());
+
+  for (const auto &block : blocks) {
+    patterns.push_back(XmLoader::decodePattern(
+        block, header.channels, instruments, tunings, lastInstruments));
+  }
+
+  std::vector<int> &orders = header.orders;
+
+  // Orders past song length are not played, missing patterns play empty.
+  for (size_t i = 0; i < orders.size(); i++) {
+    if (i >= header.songLength) {
+      orders[i] = 0;
+      continue;
+    }
+
+    while ((size_t)orders[i] >= patterns.size()) {
+      patterns.push_back(XmLoader::decodePattern(
+          PatternBlock{}, header.channels, instruments, tunings,
+          lastInstruments));
+    }
+  }
+
+  // Generator starts at default speed, initial speed is set on first row.
+  if (header.tempo != defaultTempo && header.tempo != 0 &&
+      header.tempo < 0x20 && header.songLength > 0) {
+    Row &row = patterns[orders[0]].getRow(0);
+
+    for (size_t channel = 0; channel < header.channels; channel++) {
+      const Note &note = row.getNote(channel);
+
+      if (note.effectNumber == 0 && note.effectParameter == 0) {
+        std::vector<Note> notes = row.getNotes();
+
+        notes[channel].effectNumber = speedEffect;
+        notes[channel].effectParameter = (int)header.tempo;
+        row = Row(std::move(notes));
+        break;
+      }
+    }
+  }
+
+  return std::make_shared<Mod>(header.name, header.songLength,
+                               std::move(samples), std::move(patterns),
+                               std::move(orders));
+}
+
+ModInfo XmLoader::scanData(const uint8_t *data, size_t size) {
+  constexpr size_t defaultRows = 64;
+
+  ByteReader reader(data, size);
+  const Header header = XmLoader::readHeader(reader);
+
+  reader.seek(header.patternsOffset);
+
+  const std::vector<PatternBlock> blocks =
+      XmLoader::readPatternBlocks(reader, header.patternsCount);
+
+  std::vector<Instrument> instruments;
+  std::vector<Sample> samples;
+  std::vector<SampleTuning> tunings;
+
+  XmLoader::readInstruments(reader, header.instrumentsCount, instruments,
+                            samples, tunings, false);
+
+  ModInfo info;
+
+  info.name = header.name;
+  info.channels = header.channels;
+  info.songLength = header.songLength;
+  info.patternCount = header.patternsCount;
+
+  for (const auto &sample : samples) {
+    info.sampleNames.push_back(sample.getName());
+  }
+
+  // Row lasts tempo ticks of 2.5 / BPM seconds.
+  const float secondsPerRow =
+      header.bpm == 0 ? 0.0f : (float)header.tempo * 2.5f / (float)header.bpm;
+
+  for (size_t i = 0; i < header.songLength; i++) {
+    const auto order = (size_t)header.orders[i];
+    const size_t rows = order < blocks.size() ? blocks[order].rows : defaultRows;
+
+    info.estimatedDuration += (float)rows * secondsPerRow;
+  }
+
+  return info;
+}
+
+#pragma endregion
+
+int XmLoader::probe(const uint8_t *header, size_t size) const {
+  if (size >= idLength && std::memcmp(header, idText, idLength) == 0) {
+    return 100;
+  }
+
+  return 0;
+}
+
+size_t XmLoader::getProbeSize() const { return idLength; }
+
+std::shared_ptr<Mod> XmLoader::load(std::istream &stream) {
+  if (!stream) {
+    throw std::runtime_error("Xm reading error: stream bad");
+  }
+
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)),
+                            std::istreambuf_iterator<char>());
+
+  return XmLoader::parse(data.data(), data.size());
+}
+
+std::shared_ptr<Mod> XmLoader::load(const std::string &path) {
+  const MappedFile file(path);
+
+  return XmLoader::parse(file.data(), file.size());
+}
+
+std::shared_ptr<Mod> XmLoader::load(const uint8_t *data, size_t size) {
+  return XmLoader::parse(data, size);
+}
+
+ModInfo XmLoader::scan(std::istream &stream) {
+  if (!stream) {
+    throw std::runtime_error("Xm reading error: stream bad");
+  }
+
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)),
+                            std::istreambuf_iterator<char>());
+
+  return XmLoader::scanData(data.data(), data.size());
+}
+
+ModInfo XmLoader::scan(const std::string &path) {
+  const MappedFile file(path);
+
+  return XmLoader::scanData(file.data(), file.size());
+}
+
+}  // namespace mod
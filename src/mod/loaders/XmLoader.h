@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <vector>
+
+#include "ByteReader.h"
+#include "TrackerLoader.h"
+#include "mod/Mod.h"
+
+namespace mod {
+
+/**
+ * FastTracker 2 extended module loader. Instrument samples are flattened
+ * into mod samples and notes are converted to Amiga periods of the sample
+ * their instrument maps them to, so generator plays them like mod notes.
+ * Envelopes, panning and vibrato are not supported by generator and are
+ * skipped.
+ */
+class XmLoader : public TrackerLoader {
+ private:
+  struct Header {
+    std::string name;
+    size_t songLength = 0;
+    size_t channels = 0;
+    size_t patternsCount = 0;
+    size_t instrumentsCount = 0;
+    size_t tempo = 6;
+    size_t bpm = 125;
+    std::vector<int> orders;
+    // Offset of first pattern.
+    size_t patternsOffset = 0;
+  };
+
+  struct PatternBlock {
+    size_t rows = 64;
+    // Packed notes, empty for empty pattern.
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+  };
+
+  struct Instrument {
+    size_t firstSample = 0;
+    size_t samplesCount = 0;
+    std::array<uint8_t, 96> keymap{};
+  };
+
+  // Pitch of flattened sample, applied to note periods.
+  struct SampleTuning {
+    int relativeNote = 0;
+    int finetune = 0;
+  };
+
+  /**
+   * @param reader
+   * @throws runtime_error
+   */
+  static Header readHeader(ByteReader &reader);
+
+  /**
+   * Skips over pattern data, reader is left at first instrument.
+   * @param reader
+   * @param count
+   * @throws runtime_error
+   */
+  static std::vector<PatternBlock> readPatternBlocks(ByteReader &reader,
+                                                     size_t count);
+
+  /**
+   * Reads instruments, their sample headers and delta decoded sample data.
+   * @param reader
+   * @param count
+   * @param instruments
+   * @param samples
+   * @param tunings
+   * @param decodeData If false, sample data is skipped.
+   * @throws runtime_error
+   */
+  static void readInstruments(ByteReader &reader, size_t count,
+                              std::vector<Instrument> &instruments,
+                              std::vector<Sample> &samples,
+                              std::vector<SampleTuning> &tunings,
+                              bool decodeData);
+
+  /**
+   * @param note 1 is C-0.
+   * @param tuning
+   * @return Amiga period playing note at 8363 Hz C-4.
+   */
+  static int noteToPeriod(int note, const SampleTuning &tuning);
+
+  /**
+   * Unpacks pattern into notes.
+   * @param block
+   * @param channels
+   * @param instruments
+   * @param tunings
+   * @param lastInstruments Instrument of each channel, used by notes
+   * without one. Carried between patterns in file order.
+   */
+  static Pattern decodePattern(const PatternBlock &block, size_t channels,
+                               const std::vector<Instrument> &instruments,
+                               const std::vector<SampleTuning> &tunings,
+                               std::vector<size_t> &lastInstruments);
+
+  /**
+   * @param data Whole module.
+   * @param size
+   * @throws runtime_error
+   */
+  static std::shared_ptr<Mod> parse(const uint8_t *data, size_t size);
+
+  /**
+   * @param data Whole module.
+   * @param size
+   * @throws runtime_error
+   */
+  static ModInfo scanData(const uint8_t *data, size_t size);
+
+ public:
+  ~XmLoader() override = default;
+
+  /**
+   * Checks "Extended Module: " id text.
+   * @param header
+   * @param size
+   * @return 100 for XM, 0 otherwise.
+   */
+  [[nodiscard]] int probe(const uint8_t *header, size_t size) const override;
+
+  [[nodiscard]] size_t getProbeSize() const override;
+
+  /**
+   * @param stream
+   * @throws runtime_error
+   */
+  std::shared_ptr<Mod> load(std::istream &stream) override;
+
+  /**
+   * @param path
+   * @throws runtime_error
+   */
+  std::shared_ptr<Mod> load(const std::string &path) override;
+
+  /**
+   * @param data Whole module. Not referenced after return.
+   * @param size
+   * @throws runtime_error
+   */
+  std::shared_ptr<Mod> load(const uint8_t *data, size_t size);
+
+  /**
+   * Walks pattern and instrument headers without decoding notes and sample
+   * data. Duration is exact for default tempo and BPM without speed effects.
+   * @param stream
+   * @throws runtime_error
+   */
+  ModInfo scan(std::istream &stream) override;
+
+  /**
+   * @param path
+   * @throws runtime_error
+   */
+  ModInfo scan(const std::string &path) override;
+};
+
+}  // namespace mod
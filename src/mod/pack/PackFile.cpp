@@ -0,0 +1,266 @@
+#include "PackFile.h"
+
+#include <fmt/format.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace mod {
+
+class PackFile::PackDecoder : public LazyDecoder {
+ private:
+  std::shared_ptr<const MappedFile> _file;
+  size_t _channels;
+  std::vector<pack::PatternRecord> _patterns;
+  std::vector<pack::SampleRecord> _samples;
+
+ public:
+  PackDecoder(std::shared_ptr<const MappedFile> file, size_t channels,
+              std::vector<pack::PatternRecord> patterns,
+              std::vector<pack::SampleRecord> samples)
+      : _file(std::move(file)),
+        _channels(channels),
+        _patterns(std::move(patterns)),
+        _samples(std::move(samples)) {}
+
+  [[nodiscard]] Pattern decodePattern(size_t index) const override {
+    const pack::PatternRecord &record = this->_patterns[index];
+    const auto *notes =
+        reinterpret_cast<const Note *>(this->_file->data() + record.notesOffset);
+
+    Pattern pattern(this->_channels, record.totalRows);
+
+    for (size_t row = 0; row < record.rows; row++) {
+      const Note *rowNotes = notes + row * this->_channels;
+
+      pattern.addRow(
+          Row(std::vector<Note>(rowNotes, rowNotes + this->_channels)));
+    }
+
+    return pattern;
+  }
+
+  void decodeSample(size_t index, Sample &sample) const override {
+    const pack::SampleRecord &record = this->_samples[index];
+
+    if (record.dataSize == 0) {
+      sample.setData(std::vector<float>());
+      return;
+    }
+
+    const auto *data = reinterpret_cast<const float *>(this->_file->data() +
+                                                        record.dataOffset);
+
+    sample.setData(SampleData(std::shared_ptr<const float>(this->_file, data),
+                              record.dataSize));
+  }
+};
+
+#pragma region private
+
+uint64_t PackFile::find(const std::string &name) const {
+  const uint64_t hash = pack::hashName(name);
+  const uint64_t mask = this->_header.bucketCount - 1;
+  const auto *buckets = reinterpret_cast<const pack::IndexBucket *>(
+      this->_file->data() + this->_header.indexOffset);
+
+  // Damaged index may have no empty bucket, so every bucket is tried once.
+  for (uint64_t step = 0, i = hash & mask; step < this->_header.bucketCount;
+       step++, i = (i + 1) & mask) {
+    const pack::IndexBucket &bucket = buckets[i];
+
+    if (bucket.entryOffset == 0) {
+      return 0;
+    }
+
+    if (bucket.hash != hash) {
+      continue;
+    }
+
+    pack::EntryHeader header{};
+
+    this->checkRange(bucket.entryOffset, sizeof(header));
+    std::memcpy(&header, this->_file->data() + bucket.entryOffset,
+                sizeof(header));
+
+    if (this->readString(header.nameOffset, header.nameLength) == name) {
+      return bucket.entryOffset;
+    }
+  }
+
+  return 0;
+}
+
+void PackFile::checkRange(uint64_t offset, uint64_t size) const {
+  if (offset > this->_file->size() || size > this->_file->size() - offset) {
+    throw std::runtime_error(
+        fmt::format("Pack range {}+{} is outside of pack of {} bytes", offset,
+                    size, this->_file->size()));
+  }
+}
+
+std::string PackFile::readString(uint64_t offset, uint64_t length) const {
+  this->checkRange(offset, length);
+
+  return {reinterpret_cast<const char *>(this->_file->data() + offset),
+          length};
+}
+
+#pragma endregion
+
+#pragma region public constructor
+
+PackFile::PackFile(const std::string &path)
+    : _file(std::make_shared<const MappedFile>(path)) {
+  if (this->_file->size() < sizeof(pack::FileHeader)) {
+    throw std::runtime_error(fmt::format("'{}' is too short for pack", path));
+  }
+
+  std::memcpy(&this->_header, this->_file->data(), sizeof(this->_header));
+
+  if (std::memcmp(this->_header.magic, pack::magic, sizeof(pack::magic)) !=
+      0) {
+    throw std::runtime_error(
+        fmt::format("'{}' is not a finished mod pack", path));
+  }
+
+  if (this->_header.byteOrder != pack::byteOrder ||
+      this->_header.version != pack::version) {
+    throw std::runtime_error(fmt::format(
+        "'{}' is mod pack of version {} or of other byte order", path,
+        this->_header.version));
+  }
+
+  const uint64_t bucketCount = this->_header.bucketCount;
+
+  if (bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0 ||
+      this->_header.entryCount >= bucketCount ||
+      this->_header.indexOffset % alignof(pack::IndexBucket) != 0) {
+    throw std::runtime_error(fmt::format("'{}' has damaged index", path));
+  }
+
+  this->checkRange(this->_header.indexOffset,
+                   bucketCount * sizeof(pack::IndexBucket));
+}
+
+#pragma endregion
+
+#pragma region public
+
+bool PackFile::contains(const std::string &name) const {
+  return this->find(name) != 0;
+}
+
+std::shared_ptr<Mod> PackFile::load(const std::string &name) const {
+  const uint64_t offset = this->find(name);
+
+  if (offset == 0) {
+    throw std::out_of_range(fmt::format("load: No '{}' in pack", name));
+  }
+
+  const uint8_t *data = this->_file->data();
+  pack::EntryHeader header{};
+
+  std::memcpy(&header, data + offset, sizeof(header));
+
+  if (header.songLength > header.orderCount) {
+    throw std::runtime_error(fmt::format(
+        "load: Song length {} is past {} orders in '{}'", header.songLength,
+        header.orderCount, name));
+  }
+
+  this->checkRange(header.samplesOffset,
+                   header.sampleCount * sizeof(pack::SampleRecord));
+  this->checkRange(header.patternsOffset,
+                   header.patternCount * sizeof(pack::PatternRecord));
+  this->checkRange(header.ordersOffset, header.orderCount * sizeof(int32_t));
+
+  std::vector<pack::SampleRecord> sampleRecords(header.sampleCount);
+  std::vector<pack::PatternRecord> patternRecords(header.patternCount);
+  std::vector<int32_t> storedOrders(header.orderCount);
+
+  std::memcpy(sampleRecords.data(), data + header.samplesOffset,
+              sampleRecords.size() * sizeof(pack::SampleRecord));
+  std::memcpy(patternRecords.data(), data + header.patternsOffset,
+              patternRecords.size() * sizeof(pack::PatternRecord));
+  std::memcpy(storedOrders.data(), data + header.ordersOffset,
+              storedOrders.size() * sizeof(int32_t));
+
+  std::vector<Sample> samples;
+
+  samples.reserve(sampleRecords.size());
+
+  for (const auto &record : sampleRecords) {
+    if (record.dataSize != 0 &&
+        record.dataOffset % alignof(float) != 0) {
+      throw std::runtime_error(
+          fmt::format("load: Misaligned sample data in '{}'", name));
+    }
+
+    this->checkRange(record.dataOffset, record.dataSize * sizeof(float));
+
+    samples.emplace_back(this->readString(record.nameOffset, record.nameLength),
+                         record.length, record.finetune, record.volume,
+                         record.repeatPoint, record.repeatLength,
+                         record.dataFrequency);
+  }
+
+  for (const auto &record : patternRecords) {
+    if (record.rows > record.totalRows ||
+        record.notesOffset % alignof(Note) != 0) {
+      throw std::runtime_error(
+          fmt::format("load: Damaged pattern in '{}'", name));
+    }
+
+    this->checkRange(record.notesOffset,
+                     (uint64_t)record.rows * header.channels * sizeof(Note));
+  }
+
+  std::vector<int> orders(storedOrders.begin(), storedOrders.end());
+
+  for (const auto order : orders) {
+    if (order < 0 || (uint32_t)order >= header.patternCount) {
+      throw std::runtime_error(
+          fmt::format("load: Order out of range in '{}'", name));
+    }
+  }
+
+  auto decoder = std::make_shared<const PackDecoder>(
+      this->_file, header.channels, std::move(patternRecords),
+      std::move(sampleRecords));
+
+  return std::make_shared<Mod>(
+      this->readString(header.titleOffset, header.titleLength),
+      header.songLength, header.channels, std::move(samples),
+      header.patternCount, std::move(orders), std::move(decoder));
+}
+
+size_t PackFile::getEntryCount() const { return this->_header.entryCount; }
+
+std::vector<std::string> PackFile::getNames() const {
+  const auto *buckets = reinterpret_cast<const pack::IndexBucket *>(
+      this->_file->data() + this->_header.indexOffset);
+  std::vector<std::string> names;
+
+  names.reserve(this->_header.entryCount);
+
+  for (uint64_t i = 0; i < this->_header.bucketCount; i++) {
+    if (buckets[i].entryOffset == 0) {
+      continue;
+    }
+
+    pack::EntryHeader header{};
+
+    this->checkRange(buckets[i].entryOffset, sizeof(header));
+    std::memcpy(&header, this->_file->data() + buckets[i].entryOffset,
+                sizeof(header));
+
+    names.push_back(this->readString(header.nameOffset, header.nameLength));
+  }
+
+  return names;
+}
+
+#pragma endregion
+
+}  // namespace mod
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "PackFormat.h"
+#include "mod/Mod.h"
+
+namespace mod {
+
+/**
+ * Memory mapped library pack written by PackWriter. Loaded mods decode
+ * patterns on first access by copying stored notes, sample data is used
+ * from mapping without copying. Mapping stays alive while any loaded mod
+ * does.
+ */
+class PackFile {
+ private:
+  class PackDecoder;
+
+  std::shared_ptr<const MappedFile> _file;
+  pack::FileHeader _header{};
+
+  /**
+   * @param name
+   * @return Entry offset, or 0 if there is no such entry.
+   */
+  [[nodiscard]] uint64_t find(const std::string &name) const;
+
+  /**
+   * @param offset
+   * @param size
+   * @throws runtime_error If range is outside of pack.
+   */
+  void checkRange(uint64_t offset, uint64_t size) const;
+
+  /**
+   * @param offset
+   * @param length
+   * @throws runtime_error
+   */
+  [[nodiscard]] std::string readString(uint64_t offset, uint64_t length) const;
+
+ public:
+  /**
+   * Maps pack and checks its header and index.
+   * @param path
+   * @throws runtime_error If file is not a finished pack of this version.
+   */
+  explicit PackFile(const std::string &path);
+
+  [[nodiscard]] bool contains(const std::string &name) const;
+
+  /**
+   * Time does not depend on size of patterns and sample data.
+   * @param name
+   * @throws out_of_range If there is no such entry.
+   * @throws runtime_error If entry is damaged.
+   */
+  [[nodiscard]] std::shared_ptr<Mod> load(const std::string &name) const;
+
+  [[nodiscard]] size_t getEntryCount() const;
+
+  /**
+   * @return Names of all entries, in index order.
+   */
+  [[nodiscard]] std::vector<std::string> getNames() const;
+};
+
+}  // namespace mod
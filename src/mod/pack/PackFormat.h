@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "mod/Note.h"
+
+/**
+ * Layout of library pack file. All offsets are from start of file, values
+ * are in byte order of writing host, checked through byteOrder on open.
+ *
+ * FileHeader, then entries, then index of bucketCount IndexBuckets. Entry is
+ * EntryHeader, SampleRecords, PatternRecords, orders as int32, string data,
+ * then 64 byte aligned notes of all patterns and float data of all samples.
+ */
+namespace mod::pack {
+
+constexpr char magic[8] = {'M', 'O', 'D', 'P', 'A', 'C', 'K', '\0'};
+constexpr uint32_t version = 1;
+constexpr uint32_t byteOrder = 0x01020304;
+constexpr size_t dataAlignment = 64;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t entryCount;
+  uint64_t indexOffset;
+  // Power of two.
+  uint64_t bucketCount;
+};
+
+struct IndexBucket {
+  uint64_t hash;
+  // 0 if bucket is empty.
+  uint64_t entryOffset;
+};
+
+struct EntryHeader {
+  uint64_t nameOffset;
+  uint64_t nameLength;
+  uint64_t titleOffset;
+  uint64_t titleLength;
+  uint32_t channels;
+  uint32_t songLength;
+  uint32_t sampleCount;
+  uint32_t patternCount;
+  uint32_t orderCount;
+  uint32_t reserved;
+  uint64_t samplesOffset;
+  uint64_t patternsOffset;
+  uint64_t ordersOffset;
+  uint64_t endOffset;
+};
+
+struct SampleRecord {
+  uint64_t nameOffset;
+  uint64_t nameLength;
+  int32_t length;
+  int32_t finetune;
+  int32_t volume;
+  int32_t repeatPoint;
+  int32_t repeatLength;
+  float dataFrequency;
+  // Floats, dataSize values long.
+  uint64_t dataOffset;
+  uint64_t dataSize;
+};
+
+struct PatternRecord {
+  uint32_t totalRows;
+  uint32_t rows;
+  // Notes, rows * channels values long.
+  uint64_t notesOffset;
+};
+
+static_assert(std::is_trivially_copyable_v<Note> && sizeof(Note) == 16,
+              "Notes are stored in pack as is.");
+
+/**
+ * FNV-1a of entry name.
+ * @param name
+ */
+inline uint64_t hashName(const std::string &name) {
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (const char character : name) {
+    hash ^= (uint8_t)character;
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+inline uint64_t alignOffset(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace mod::pack
@@ -0,0 +1,243 @@
+#include "PackWriter.h"
+
+#include <fmt/format.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include "exceptions/BadStateException.h"
+
+namespace mod {
+
+#pragma region private
+
+void PackWriter::writeBytes(const void *data, size_t size) {
+  this->_stream.write(reinterpret_cast<const char *>(data),
+                      (std::streamsize)size);
+
+  if (!this->_stream) {
+    throw std::runtime_error("PackWriter: stream write failed");
+  }
+
+  this->_position += size;
+}
+
+#pragma endregion
+
+#pragma region public constructor
+
+PackWriter::PackWriter(std::ostream &stream)
+    : _stream(stream), _start(stream.tellp()) {
+  if (!this->_stream || this->_start == std::streampos(-1)) {
+    throw std::runtime_error("PackWriter: stream is not writable or seekable");
+  }
+
+  const pack::FileHeader header{};
+
+  this->writeBytes(&header, sizeof(header));
+}
+
+#pragma endregion
+
+#pragma region public
+
+void PackWriter::add(const std::string &name, const Mod &mod) {
+  using namespace pack;
+
+  if (this->_finished) {
+    throw BadStateException("add: Pack was already finished.");
+  }
+
+  if (this->_names.count(name) != 0) {
+    throw std::invalid_argument(
+        fmt::format("add: Entry '{}' was already added", name));
+  }
+
+  const std::vector<Sample> &samples = mod.getSamples();
+  const std::vector<Pattern> &patterns = mod.getPatterns();
+  const std::vector<int> &orders = mod.getOrders();
+  const size_t channels = mod.getChannels();
+
+  const uint64_t start = alignOffset(this->_position, dataAlignment);
+  std::vector<uint8_t> entry;
+
+  // Returns offset from start of file.
+  const auto allocate = [&entry, start](size_t size, size_t alignment) {
+    const size_t offset = alignOffset(start + entry.size(), alignment) - start;
+
+    entry.resize(offset + size);
+
+    return start + offset;
+  };
+  const auto at = [&entry, start](uint64_t offset) {
+    return entry.data() + (offset - start);
+  };
+  const auto allocateString = [&](const std::string &value) {
+    const uint64_t offset = allocate(value.size(), 1);
+
+    std::memcpy(at(offset), value.data(), value.size());
+
+    return offset;
+  };
+
+  const uint64_t headerOffset = allocate(sizeof(EntryHeader), 8);
+  const uint64_t samplesOffset =
+      allocate(samples.size() * sizeof(SampleRecord), 8);
+  const uint64_t patternsOffset =
+      allocate(patterns.size() * sizeof(PatternRecord), 8);
+  const uint64_t ordersOffset = allocate(orders.size() * sizeof(int32_t), 4);
+
+  for (size_t i = 0; i < orders.size(); i++) {
+    const auto order = (int32_t)orders[i];
+
+    std::memcpy(at(ordersOffset + i * sizeof(int32_t)), &order, sizeof(order));
+  }
+
+  EntryHeader header{};
+
+  header.nameOffset = allocateString(name);
+  header.nameLength = name.size();
+  header.titleOffset = allocateString(mod.getName());
+  header.titleLength = mod.getName().size();
+  header.channels = channels;
+  header.songLength = mod.getSongLength();
+  header.sampleCount = samples.size();
+  header.patternCount = patterns.size();
+  header.orderCount = orders.size();
+  header.samplesOffset = samplesOffset;
+  header.patternsOffset = patternsOffset;
+  header.ordersOffset = ordersOffset;
+
+  std::vector<SampleRecord> sampleRecords(samples.size());
+
+  for (size_t i = 0; i < samples.size(); i++) {
+    const Sample &sample = samples[i];
+    SampleRecord &record = sampleRecords[i];
+
+    record.nameOffset = allocateString(sample.getName());
+    record.nameLength = sample.getName().size();
+    record.length = sample.getLength();
+    record.finetune = sample.getFinetune();
+    record.volume = sample.getVolume();
+    record.repeatPoint = sample.getRepeatPoint();
+    record.repeatLength = sample.getRepeatLength();
+    record.dataFrequency = sample.getDataFrequency();
+  }
+
+  std::vector<PatternRecord> patternRecords(patterns.size());
+
+  for (size_t i = 0; i < patterns.size(); i++) {
+    const std::vector<Row> &rows = patterns[i].getRows();
+    PatternRecord &record = patternRecords[i];
+
+    record.totalRows = patterns[i].getTotalRows();
+    record.rows = rows.size();
+    record.notesOffset =
+        allocate(rows.size() * channels * sizeof(Note), dataAlignment);
+
+    for (size_t row = 0; row < rows.size(); row++) {
+      const std::vector<Note> &notes = rows[row].getNotes();
+
+      if (notes.size() != channels) {
+        throw std::runtime_error(
+            fmt::format("add: Row {} of pattern {} in '{}' has {} notes, "
+                        "expected {}",
+                        row, i, name, notes.size(), channels));
+      }
+
+      std::memcpy(at(record.notesOffset + row * channels * sizeof(Note)),
+                  notes.data(), channels * sizeof(Note));
+    }
+  }
+
+  for (size_t i = 0; i < samples.size(); i++) {
+    if (samples[i].getLength() == 0) {
+      continue;
+    }
+
+    const SampleData &data = samples[i].getData();
+    SampleRecord &record = sampleRecords[i];
+
+    record.dataSize = data.size();
+    record.dataOffset = allocate(data.size() * sizeof(float), dataAlignment);
+
+    std::memcpy(at(record.dataOffset), data.data(),
+                data.size() * sizeof(float));
+  }
+
+  header.endOffset = start + entry.size();
+
+  std::memcpy(at(headerOffset), &header, sizeof(header));
+  std::memcpy(at(samplesOffset), sampleRecords.data(),
+              sampleRecords.size() * sizeof(SampleRecord));
+  std::memcpy(at(patternsOffset), patternRecords.data(),
+              patternRecords.size() * sizeof(PatternRecord));
+
+  const std::vector<uint8_t> padding(start - this->_position, 0);
+
+  this->writeBytes(padding.data(), padding.size());
+  this->writeBytes(entry.data(), entry.size());
+
+  this->_names.insert(name);
+  this->_index.push_back({hashName(name), start});
+}
+
+void PackWriter::finish() {
+  using namespace pack;
+
+  if (this->_finished) {
+    throw BadStateException("finish: Pack was already finished.");
+  }
+
+  uint64_t bucketCount = 1;
+
+  while (bucketCount < this->_index.size() * 2) {
+    bucketCount *= 2;
+  }
+
+  std::vector<IndexBucket> buckets(bucketCount, IndexBucket{0, 0});
+
+  for (const auto &entry : this->_index) {
+    uint64_t bucket = entry.hash & (bucketCount - 1);
+
+    while (buckets[bucket].entryOffset != 0) {
+      bucket = (bucket + 1) & (bucketCount - 1);
+    }
+
+    buckets[bucket] = {entry.hash, entry.offset};
+  }
+
+  const uint64_t indexOffset = alignOffset(this->_position, 8);
+  const std::vector<uint8_t> padding(indexOffset - this->_position, 0);
+
+  this->writeBytes(padding.data(), padding.size());
+  this->writeBytes(buckets.data(), buckets.size() * sizeof(IndexBucket));
+
+  FileHeader header{};
+
+  std::memcpy(header.magic, pack::magic, sizeof(header.magic));
+  header.version = pack::version;
+  header.byteOrder = pack::byteOrder;
+  header.entryCount = this->_index.size();
+  header.indexOffset = indexOffset;
+  header.bucketCount = bucketCount;
+
+  const std::streampos end = this->_stream.tellp();
+
+  this->_stream.seekp(this->_start);
+  this->_stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  this->_stream.seekp(end);
+  this->_stream.flush();
+
+  if (!this->_stream) {
+    throw std::runtime_error("PackWriter: stream write failed");
+  }
+
+  this->_finished = true;
+}
+
+size_t PackWriter::getEntryCount() const { return this->_index.size(); }
+
+#pragma endregion
+
+}  // namespace mod
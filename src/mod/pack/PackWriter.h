@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "PackFormat.h"
+#include "mod/Mod.h"
+
+namespace mod {
+
+/**
+ * Writes mods into library pack, one entry after another, so only index is
+ * kept in memory. See PackFormat.h for layout.
+ */
+class PackWriter {
+ private:
+  struct IndexEntry {
+    uint64_t hash;
+    uint64_t offset;
+  };
+
+  std::ostream &_stream;
+  std::vector<IndexEntry> _index;
+  std::unordered_set<std::string> _names;
+  std::streampos _start;
+  uint64_t _position = 0;
+  bool _finished = false;
+
+  /**
+   * @throws runtime_error
+   */
+  void writeBytes(const void *data, size_t size);
+
+ public:
+  /**
+   * Writes placeholder header, so unfinished pack is rejected on open.
+   * @param stream Seekable, header is rewritten by finish.
+   * @throws runtime_error
+   */
+  explicit PackWriter(std::ostream &stream);
+
+  /**
+   * Decoded patterns and sample data of mod are stored as is.
+   * @param name Key of entry in index.
+   * @param mod
+   * @throws invalid_argument If name was already added.
+   * @throws BadStateException If pack was finished.
+   * @throws runtime_error
+   */
+  void add(const std::string &name, const Mod &mod);
+
+  /**
+   * Writes index and header. Pack is not valid until called.
+   * @throws BadStateException If pack was finished.
+   * @throws runtime_error
+   */
+  void finish();
+
+  [[nodiscard]] size_t getEntryCount() const;
+};
+
+}  // namespace mod
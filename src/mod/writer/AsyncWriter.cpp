@@ -0,0 +1,629 @@
+#include "AsyncWriter.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "EncodingGuard.h"
+#include "WavWriter.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ASYNC_WRITER_PWRITE
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ASYNC_WRITER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+namespace mod {
+
+namespace {
+
+#ifdef ASYNC_WRITER_PWRITE
+
+/**
+ * @param path
+ * @return Descriptor of created or truncated file.
+ * @throws runtime_error
+ */
+int createFile(const std::string &path) {
+  const int fd =
+      ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd < 0) {
+    throw std::runtime_error(
+        fmt::format("Cannot create '{}': {}", path, std::strerror(errno)));
+  }
+
+  return fd;
+}
+
+/**
+ * Writes whole data, continuing after short writes and interrupts.
+ * @return Empty string on success, error otherwise.
+ */
+std::string writeFully(int fd, const uint8_t *data, size_t size,
+                       uint64_t offset) {
+  while (size > 0) {
+    const ssize_t written = pwrite(fd, data, size, (off_t)offset);
+
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (written <= 0) {
+      return fmt::format("Cannot write {} bytes at offset {}: {}", size,
+                         offset, std::strerror(written < 0 ? errno : EIO));
+    }
+
+    data += written;
+    size -= (size_t)written;
+    offset += (uint64_t)written;
+  }
+
+  return "";
+}
+
+#endif
+
+}  // namespace
+
+#pragma region private
+
+/**
+ * File receiving blocks of numbered slots. Block data must stay valid until
+ * wait for its slot returns.
+ */
+class AsyncWriter::Output {
+ public:
+  virtual ~Output() = default;
+
+  /**
+   * @param slot Slot without write in flight.
+   * @param data
+   * @param size
+   * @param offset
+   * @throws runtime_error
+   */
+  virtual void submit(size_t slot, const uint8_t *data, size_t size,
+                      uint64_t offset) = 0;
+
+  /**
+   * Waits until write of slot is done. Returns immediately for idle slot.
+   * @param slot
+   * @throws runtime_error If write failed.
+   */
+  virtual void wait(size_t slot) = 0;
+};
+
+/**
+ * Writes done one after another by background thread.
+ */
+class AsyncWriter::ThreadOutput : public AsyncWriter::Output {
+ private:
+  struct Job {
+    size_t slot;
+    const uint8_t *data;
+    size_t size;
+    uint64_t offset;
+  };
+
+#ifdef ASYNC_WRITER_PWRITE
+  int _fd;
+#else
+  std::ofstream _stream;
+#endif
+  std::mutex _mutex;
+  std::condition_variable _changed;
+  std::deque<Job> _jobs;
+  std::vector<bool> _pending;
+  std::string _error;
+  bool _stopping = false;
+  std::thread _thread;
+
+  void run() {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+
+    while (true) {
+      this->_changed.wait(
+          lock, [this]() { return this->_stopping || !this->_jobs.empty(); });
+
+      if (this->_stopping) {
+        return;
+      }
+
+      const Job job = this->_jobs.front();
+
+      this->_jobs.pop_front();
+      lock.unlock();
+
+      std::string error = this->writeJob(job);
+
+      lock.lock();
+
+      if (this->_error.empty()) {
+        this->_error = std::move(error);
+      }
+
+      this->_pending[job.slot] = false;
+      this->_changed.notify_all();
+    }
+  }
+
+  std::string writeJob(const Job &job) {
+#ifdef ASYNC_WRITER_PWRITE
+    return writeFully(this->_fd, job.data, job.size, job.offset);
+#else
+    this->_stream.seekp((std::streamoff)job.offset);
+    this->_stream.write((const char *)job.data, (std::streamsize)job.size);
+
+    return this->_stream ? "" : fmt::format("Cannot write {} bytes", job.size);
+#endif
+  }
+
+ public:
+  ThreadOutput(const std::string &path, size_t slots) : _pending(slots) {
+#ifdef ASYNC_WRITER_PWRITE
+    this->_fd = createFile(path);
+#else
+    this->_stream.open(path, std::ios_base::binary | std::ios_base::trunc);
+
+    if (!this->_stream) {
+      throw std::runtime_error(fmt::format("Cannot create '{}'", path));
+    }
+#endif
+    this->_thread = std::thread(&ThreadOutput::run, this);
+  }
+
+  ~ThreadOutput() override {
+    {
+      const std::lock_guard<std::mutex> lock(this->_mutex);
+
+      this->_stopping = true;
+    }
+
+    this->_changed.notify_all();
+    this->_thread.join();
+#ifdef ASYNC_WRITER_PWRITE
+    ::close(this->_fd);
+#endif
+  }
+
+  void submit(size_t slot, const uint8_t *data, size_t size,
+              uint64_t offset) override {
+    {
+      const std::lock_guard<std::mutex> lock(this->_mutex);
+
+      this->_pending[slot] = true;
+      this->_jobs.push_back({slot, data, size, offset});
+    }
+
+    this->_changed.notify_all();
+  }
+
+  void wait(size_t slot) override {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+
+    this->_changed.wait(lock, [this, slot]() { return !this->_pending[slot]; });
+
+    if (!this->_error.empty()) {
+      throw std::runtime_error(this->_error);
+    }
+  }
+};
+
+#ifdef ASYNC_WRITER_IO_URING
+
+/**
+ * Writes submitted to kernel through io_uring rings, set up with raw system
+ * calls. Short writes are finished with pwrite.
+ */
+class AsyncWriter::IoUringOutput : public AsyncWriter::Output {
+ private:
+  struct Slot {
+    iovec vector{};
+    uint64_t offset = 0;
+    bool inFlight = false;
+    int result = 0;
+  };
+
+  int _fd = -1;
+  int _ringFd = -1;
+  void *_submissionRing = MAP_FAILED;
+  size_t _submissionRingSize = 0;
+  void *_completionRing = MAP_FAILED;
+  size_t _completionRingSize = 0;
+  io_uring_sqe *_entries = (io_uring_sqe *)MAP_FAILED;
+  size_t _entriesSize = 0;
+
+  unsigned *_submissionTail = nullptr;
+  unsigned *_submissionMask = nullptr;
+  unsigned *_submissionArray = nullptr;
+  unsigned *_completionHead = nullptr;
+  unsigned *_completionTail = nullptr;
+  unsigned *_completionMask = nullptr;
+  io_uring_cqe *_completions = nullptr;
+
+  std::vector<Slot> _slots;
+
+  static int enter(int ringFd, unsigned toSubmit, unsigned minComplete,
+                   unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete,
+                        flags, nullptr, 0);
+  }
+
+  /**
+   * Moves one completion, waiting for it if there is none.
+   * @throws runtime_error
+   */
+  void reap() {
+    const unsigned head = *this->_completionHead;
+
+    if (head == __atomic_load_n(this->_completionTail, __ATOMIC_ACQUIRE)) {
+      if (enter(this->_ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+          errno != EINTR) {
+        throw std::runtime_error(fmt::format("io_uring wait failed: {}",
+                                             std::strerror(errno)));
+      }
+
+      return;
+    }
+
+    const io_uring_cqe &completion =
+        this->_completions[head & *this->_completionMask];
+    Slot &slot = this->_slots[completion.user_data];
+
+    slot.result = completion.res;
+    slot.inFlight = false;
+
+    __atomic_store_n(this->_completionHead, head + 1, __ATOMIC_RELEASE);
+  }
+
+  void release() {
+    for (const auto &slot : this->_slots) {
+      while (slot.inFlight) {
+        try {
+          this->reap();
+        } catch (const std::runtime_error &) {
+          break;
+        }
+      }
+    }
+
+    if (this->_entries != MAP_FAILED) {
+      munmap(this->_entries, this->_entriesSize);
+    }
+
+    if (this->_completionRing != MAP_FAILED &&
+        this->_completionRing != this->_submissionRing) {
+      munmap(this->_completionRing, this->_completionRingSize);
+    }
+
+    if (this->_submissionRing != MAP_FAILED) {
+      munmap(this->_submissionRing, this->_submissionRingSize);
+    }
+
+    if (this->_ringFd >= 0) {
+      ::close(this->_ringFd);
+    }
+
+    if (this->_fd >= 0) {
+      ::close(this->_fd);
+    }
+  }
+
+ public:
+  IoUringOutput(const std::string &path, size_t slots) : _slots(slots) {
+    this->_fd = createFile(path);
+
+    io_uring_params params{};
+
+    this->_ringFd =
+        (int)syscall(__NR_io_uring_setup, (unsigned)slots, &params);
+
+    if (this->_ringFd < 0) {
+      const int error = errno;
+
+      this->release();
+
+      throw std::runtime_error(
+          fmt::format("io_uring setup failed: {}", std::strerror(error)));
+    }
+
+    this->_submissionRingSize =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    this->_completionRingSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    const bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    if (singleMapping) {
+      this->_submissionRingSize = this->_completionRingSize =
+          std::max(this->_submissionRingSize, this->_completionRingSize);
+    }
+
+    this->_submissionRing =
+        mmap(nullptr, this->_submissionRingSize, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, this->_ringFd, IORING_OFF_SQ_RING);
+    this->_completionRing =
+        singleMapping
+            ? this->_submissionRing
+            : mmap(nullptr, this->_completionRingSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, this->_ringFd,
+                   IORING_OFF_CQ_RING);
+    this->_entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    this->_entries = (io_uring_sqe *)mmap(
+        nullptr, this->_entriesSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, this->_ringFd, IORING_OFF_SQES);
+
+    if (this->_submissionRing == MAP_FAILED ||
+        this->_completionRing == MAP_FAILED ||
+        this->_entries == MAP_FAILED) {
+      const int error = errno;
+
+      this->release();
+
+      throw std::runtime_error(
+          fmt::format("io_uring mapping failed: {}", std::strerror(error)));
+    }
+
+    auto *submission = (uint8_t *)this->_submissionRing;
+    auto *completion = (uint8_t *)this->_completionRing;
+
+    this->_submissionTail = (unsigned *)(submission + params.sq_off.tail);
+    this->_submissionMask = (unsigned *)(submission + params.sq_off.ring_mask);
+    this->_submissionArray = (unsigned *)(submission + params.sq_off.array);
+    this->_completionHead = (unsigned *)(completion + params.cq_off.head);
+    this->_completionTail = (unsigned *)(completion + params.cq_off.tail);
+    this->_completionMask = (unsigned *)(completion + params.cq_off.ring_mask);
+    this->_completions = (io_uring_cqe *)(completion + params.cq_off.cqes);
+  }
+
+  ~IoUringOutput() override { this->release(); }
+
+  void submit(size_t slotIndex, const uint8_t *data, size_t size,
+              uint64_t offset) override {
+    Slot &slot = this->_slots[slotIndex];
+
+    slot.vector.iov_base = (void *)data;
+    slot.vector.iov_len = size;
+    slot.offset = offset;
+
+    // Only this thread submits, so tail is read without synchronization.
+    const unsigned tail = *this->_submissionTail;
+    const unsigned index = tail & *this->_submissionMask;
+    io_uring_sqe &entry = this->_entries[index];
+
+    std::memset(&entry, 0, sizeof(entry));
+    // Vectored write is available since first io_uring kernels.
+    entry.opcode = IORING_OP_WRITEV;
+    entry.fd = this->_fd;
+    entry.addr = (uint64_t)&slot.vector;
+    entry.len = 1;
+    entry.off = offset;
+    entry.user_data = slotIndex;
+
+    this->_submissionArray[index] = index;
+    __atomic_store_n(this->_submissionTail, tail + 1, __ATOMIC_RELEASE);
+
+    slot.inFlight = true;
+
+    int submitted;
+
+    do {
+      submitted = enter(this->_ringFd, 1, 0, 0);
+    } while (submitted < 0 && errno == EINTR);
+
+    if (submitted < 0) {
+      throw std::runtime_error(fmt::format("io_uring submit failed: {}",
+                                           std::strerror(errno)));
+    }
+  }
+
+  void wait(size_t slotIndex) override {
+    Slot &slot = this->_slots[slotIndex];
+
+    while (slot.inFlight) {
+      this->reap();
+    }
+
+    if (slot.vector.iov_len == 0) {
+      return;
+    }
+
+    const int result = slot.result;
+    const auto *data = (const uint8_t *)slot.vector.iov_base;
+    const size_t size = slot.vector.iov_len;
+
+    slot.vector.iov_len = 0;
+
+    if (result < 0) {
+      throw std::runtime_error(
+          fmt::format("Cannot write {} bytes at offset {}: {}", size,
+                      slot.offset, std::strerror(-result)));
+    }
+
+    const auto written = (size_t)result;
+
+    if (written < size) {
+      const std::string error = writeFully(this->_fd, data + written,
+                                           size - written,
+                                           slot.offset + written);
+
+      if (!error.empty()) {
+        throw std::runtime_error(error);
+      }
+    }
+  }
+};
+
+#endif
+
+#pragma endregion
+
+#pragma region public
+
+AsyncWriter::AsyncWriter(OutputFormat format, size_t blockSize,
+                         size_t buffersCount, Backend backend)
+    : _format(format),
+      _blockSize(blockSize),
+      _buffersCount(buffersCount),
+      _backend(backend) {
+  this->setBuffersCount(buffersCount);
+}
+
+void AsyncWriter::setFormat(OutputFormat format) { this->_format = format; }
+
+OutputFormat AsyncWriter::getFormat() const { return this->_format; }
+
+void AsyncWriter::setBlockSize(size_t blockSize) {
+  this->_blockSize = blockSize;
+}
+
+size_t AsyncWriter::getBlockSize() const { return this->_blockSize; }
+
+void AsyncWriter::setBuffersCount(size_t buffersCount) {
+  if (buffersCount < 2) {
+    throw std::invalid_argument(fmt::format(
+        "At least 2 buffers are needed to overlap writes. Have {}",
+        buffersCount));
+  }
+
+  this->_buffersCount = buffersCount;
+}
+
+size_t AsyncWriter::getBuffersCount() const { return this->_buffersCount; }
+
+void AsyncWriter::setBackend(Backend backend) { this->_backend = backend; }
+
+AsyncWriter::Backend AsyncWriter::getBackend() const { return this->_backend; }
+
+bool AsyncWriter::isIoUringAvailable() {
+#ifdef ASYNC_WRITER_IO_URING
+  // Kernel may lack io_uring or sandbox may forbid it.
+  static const bool available = []() {
+    io_uring_params params{};
+    const int ringFd = (int)syscall(__NR_io_uring_setup, 1u, &params);
+
+    if (ringFd < 0) {
+      return false;
+    }
+
+    ::close(ringFd);
+
+    return true;
+  }();
+
+  return available;
+#else
+  return false;
+#endif
+}
+
+size_t AsyncWriter::write(Generator &generator, const std::string &path) const {
+  if (this->_format == OutputFormat::Flac) {
+    throw std::invalid_argument("write: FLAC is not supported, use FlacWriter");
+  }
+
+  const Encoding originalEncoding = generator.getAudioDataEncoding();
+  const Encoding encoding = this->_format == OutputFormat::Wav
+                                ? WavWriter::toWavEncoding(originalEncoding)
+                                : originalEncoding;
+  const size_t bytesPerFrame = bytesInEncoding(encoding);
+  const size_t dataSize = generator.countFrames() * bytesPerFrame;
+  const size_t headerSize =
+      this->_format == OutputFormat::Wav ? WavWriter::headerSize : 0;
+
+  if (this->_format == OutputFormat::Wav &&
+      dataSize > std::numeric_limits<uint32_t>::max() - headerSize) {
+    throw std::runtime_error(
+        fmt::format("write: {} bytes of audio do not fit in WAV", dataSize));
+  }
+
+  const bool useIoUring =
+      this->_backend == Backend::IoUring ||
+      (this->_backend == Backend::Auto && AsyncWriter::isIoUringAvailable());
+
+  if (useIoUring && !AsyncWriter::isIoUringAvailable()) {
+    throw std::runtime_error("write: io_uring is not available");
+  }
+
+  const size_t blockSize = std::max(
+      bytesPerFrame, this->_blockSize / bytesPerFrame * bytesPerFrame);
+  // Last slot holds header.
+  const size_t headerSlot = this->_buffersCount;
+  std::array<uint8_t, WavWriter::headerSize> header{};
+
+  if (headerSize != 0) {
+    header = WavWriter::createHeader((uint32_t)generator.getFrequency(),
+                                     encoding, (uint32_t)dataSize);
+  }
+
+  // Declared before output, so buffers outlive writes in flight.
+  std::vector<std::vector<uint8_t>> buffers(
+      this->_buffersCount,
+      std::vector<uint8_t>(std::min(blockSize, dataSize)));
+  std::unique_ptr<Output> output;
+
+#ifdef ASYNC_WRITER_IO_URING
+  if (useIoUring) {
+    output = std::make_unique<IoUringOutput>(path, this->_buffersCount + 1);
+  }
+#endif
+
+  if (output == nullptr) {
+    output = std::make_unique<ThreadOutput>(path, this->_buffersCount + 1);
+  }
+
+  if (headerSize != 0) {
+    output->submit(headerSlot, header.data(), header.size(), 0);
+  }
+
+  const EncodingGuard encodingGuard(generator, encoding);
+  generator.restart();
+
+  size_t block = 0;
+
+  for (size_t written = 0; written < dataSize; block++) {
+    const size_t slot = block % this->_buffersCount;
+    const size_t size = std::min(blockSize, dataSize - written);
+    std::vector<uint8_t> &buffer = buffers[slot];
+
+    output->wait(slot);
+    generator.generate(buffer.data(), size);
+    output->submit(slot, buffer.data(), size, headerSize + written);
+
+    written += size;
+  }
+
+  for (size_t slot = 0; slot <= this->_buffersCount; slot++) {
+    output->wait(slot);
+  }
+
+  return headerSize + dataSize;
+}
+
+#pragma endregion
+
+}  // namespace mod
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+
+#include "OutputFormat.h"
+#include "mod/Generator.h"
+
+namespace mod {
+
+/**
+ * Writes song to file with rendering and disk writes overlapped. Blocks are
+ * rendered into a ring of buffers, each submitted for writing as soon as it
+ * is full, while generator renders into the next one. Rendering waits only
+ * when every buffer is still being written.
+ */
+class AsyncWriter {
+ public:
+  enum class Backend {
+    // io_uring where kernel allows it, thread otherwise.
+    Auto = 0,
+    // Writes submitted through io_uring, Linux only.
+    IoUring,
+    // Writes done by background thread with pwrite.
+    Thread,
+  };
+
+ private:
+  class Output;
+  class IoUringOutput;
+  class ThreadOutput;
+
+  OutputFormat _format;
+  size_t _blockSize;
+  size_t _buffersCount;
+  Backend _backend;
+
+ public:
+  /**
+   * @param format
+   * @param blockSize Bytes rendered into one buffer.
+   * @param buffersCount Buffers in flight, at least 2.
+   * @param backend
+   */
+  explicit AsyncWriter(OutputFormat format = OutputFormat::Raw,
+                       size_t blockSize = 1024 * 1024, size_t buffersCount = 3,
+                       Backend backend = Backend::Auto);
+
+  void setFormat(OutputFormat format);
+
+  [[nodiscard]] OutputFormat getFormat() const;
+
+  void setBlockSize(size_t blockSize);
+
+  [[nodiscard]] size_t getBlockSize() const;
+
+  /**
+   * @param buffersCount
+   * @throws invalid_argument If less than 2.
+   */
+  void setBuffersCount(size_t buffersCount);
+
+  [[nodiscard]] size_t getBuffersCount() const;
+
+  void setBackend(Backend backend);
+
+  [[nodiscard]] Backend getBackend() const;
+
+  /**
+   * @return Whether io_uring can be used in this process.
+   */
+  [[nodiscard]] static bool isIoUringAvailable();
+
+  /**
+   * Renders whole song from start. Existing file is replaced.
+   * @param generator
+   * @param path
+   * @return Bytes written.
+   * @throws invalid_argument If format is FLAC.
+   * @throws runtime_error If file cannot be created or written, io_uring
+   * was requested but is not available, or song is too long for WAV.
+   * @throws BadStateException See Generator::countFrames.
+   */
+  size_t write(Generator &generator, const std::string &path) const;
+};
+
+}  // namespace mod
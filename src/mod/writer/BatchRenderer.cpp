@@ -0,0 +1,405 @@
+#include "BatchRenderer.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include "AsyncWriter.h"
+#include "FlacWriter.h"
+#include "ThreadPool.h"
+#include "mod/Generator.h"
+#include "mod/loaders/LoaderRegistry.h"
+
+namespace mod {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr size_t asyncBlockSize = 1024 * 1024;
+constexpr size_t asyncBuffersCount = 3;
+// Samples of 8 bit mods are held as floats.
+constexpr size_t loadedBytesPerFileByte = 4;
+
+/**
+ * Limits estimated bytes and count of files in flight. Acquire waits while
+ * file would not fit, unless nothing is in flight, so oversized file does
+ * not stall batch.
+ */
+class MemoryGate {
+ private:
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  size_t _budget;
+  size_t _maxFiles;
+  size_t _used = 0;
+  size_t _files = 0;
+
+ public:
+  MemoryGate(size_t budget, size_t maxFiles)
+      : _budget(budget), _maxFiles(maxFiles) {}
+
+  void acquire(size_t bytes) {
+    std::unique_lock<std::mutex> lock(this->_mutex);
+
+    this->_condition.wait(lock, [this, bytes]() {
+      return this->_files == 0 || (this->_files < this->_maxFiles &&
+                                   this->_used + bytes <= this->_budget);
+    });
+
+    this->_used += bytes;
+    this->_files++;
+  }
+
+  /**
+   * Replaces estimate of file in flight with its actual size.
+   */
+  void resize(size_t from, size_t to) {
+    {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+
+      this->_used = this->_used - from + to;
+    }
+
+    this->_condition.notify_all();
+  }
+
+  void release(size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+
+      this->_used -= bytes;
+      this->_files--;
+    }
+
+    this->_condition.notify_all();
+  }
+};
+
+bool matchWildcard(const std::string &pattern, const std::string &name) {
+  size_t p = 0;
+  size_t n = 0;
+  // Position after last star and name position it was matched up to.
+  size_t starPattern = std::string::npos;
+  size_t starName = 0;
+
+  while (n < name.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+      p++;
+      n++;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      starPattern = ++p;
+      starName = n;
+    } else if (starPattern != std::string::npos) {
+      p = starPattern;
+      n = ++starName;
+    } else {
+      return false;
+    }
+  }
+
+  while (p < pattern.size() && pattern[p] == '*') {
+    p++;
+  }
+
+  return p == pattern.size();
+}
+
+bool isModFile(const fs::path &path) {
+  std::string extension = path.extension().string();
+
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return (char)std::tolower(c); });
+
+  return extension == ".mod" || extension == ".xm" || extension == ".s3m";
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+}  // namespace
+
+BatchRenderer::BatchRenderer(BatchOptions options)
+    : _options(std::move(options)) {}
+
+void BatchRenderer::setOptions(const BatchOptions &options) {
+  this->_options = options;
+}
+
+const BatchOptions &BatchRenderer::getOptions() const { return this->_options; }
+
+void BatchRenderer::setProgressCallback(ProgressCallback callback) {
+  this->_progressCallback = std::move(callback);
+}
+
+std::vector<BatchInput> BatchRenderer::collectInputs(
+    const std::vector<std::string> &patterns) {
+  std::vector<BatchInput> inputs;
+
+  for (const std::string &pattern : patterns) {
+    const fs::path path(pattern);
+    const std::string fileName = path.filename().string();
+    std::vector<BatchInput> matches;
+
+    if (fs::is_directory(path)) {
+      for (const auto &entry : fs::recursive_directory_iterator(path)) {
+        if (!entry.is_regular_file() || !isModFile(entry.path())) {
+          continue;
+        }
+
+        fs::path name = entry.path().lexically_relative(path);
+        name.replace_extension();
+
+        matches.push_back({entry.path().string(), name.generic_string()});
+      }
+    } else if (fileName.find_first_of("*?") != std::string::npos) {
+      const fs::path directory =
+          path.has_parent_path() ? path.parent_path() : fs::path(".");
+
+      for (const auto &entry : fs::directory_iterator(directory)) {
+        if (entry.is_regular_file() &&
+            matchWildcard(fileName, entry.path().filename().string())) {
+          matches.push_back(
+              {entry.path().string(), entry.path().stem().string()});
+        }
+      }
+    } else {
+      matches.push_back({pattern, path.stem().string()});
+    }
+
+    std::sort(matches.begin(), matches.end(),
+              [](const BatchInput &a, const BatchInput &b) {
+                return a.path < b.path;
+              });
+
+    inputs.insert(inputs.end(), matches.begin(), matches.end());
+  }
+
+  // Files differing only in extension, as song.mod and song.xm, keep it, so
+  // they are rendered to song.mod.wav and song.xm.wav.
+  std::map<std::string, std::set<std::string>> namePaths;
+
+  for (const auto &input : inputs) {
+    namePaths[input.name].insert(input.path);
+  }
+
+  for (auto &input : inputs) {
+    if (namePaths[input.name].size() > 1) {
+      input.name += fs::path(input.path).extension().string();
+    }
+  }
+
+  return inputs;
+}
+
+std::string BatchRenderer::getExtension(OutputFormat format) {
+  switch (format) {
+    case OutputFormat::Wav:
+      return ".wav";
+    case OutputFormat::Flac:
+      return ".flac";
+    default:
+      return ".raw";
+  }
+}
+
+OutputFormat BatchRenderer::formatFromString(const std::string &value) {
+  if (value == "raw") {
+    return OutputFormat::Raw;
+  }
+
+  if (value == "wav") {
+    return OutputFormat::Wav;
+  }
+
+  if (value == "flac") {
+    return OutputFormat::Flac;
+  }
+
+  throw std::invalid_argument(
+      fmt::format("formatFromString: unknown format: '{}'", value));
+}
+
+std::vector<BatchResult> BatchRenderer::render(
+    const std::vector<BatchInput> &inputs,
+    const std::string &outputDirectory) const {
+  const BatchOptions &options = this->_options;
+  const size_t workers =
+      options.workers != 0
+          ? options.workers
+          : std::max<size_t>(1, std::thread::hardware_concurrency());
+  const size_t bytesPerFrame = bytesInEncoding(options.encoding);
+
+  std::shared_ptr<ThreadPool> encodePool = nullptr;
+  size_t renderBytes;
+
+  if (options.format == OutputFormat::Flac) {
+    encodePool = std::make_shared<ThreadPool>(workers);
+
+    // Batch of rendered samples, their 32 bit copy and encoded frames.
+    renderBytes = workers * 4 * FlacWriter().getBlockSize() *
+                  (2 * bytesPerFrame + sizeof(int32_t));
+  } else {
+    renderBytes = asyncBlockSize * (asyncBuffersCount + 1) +
+                  asyncBlockSize / bytesPerFrame * sizeof(float);
+  }
+
+  std::vector<BatchResult> results(inputs.size());
+  MemoryGate gate(options.memoryBudget, workers * 2);
+  const LoaderRegistry registry = LoaderRegistry::createDefault();
+
+  std::mutex progressMutex;
+  size_t completed = 0;
+
+  const auto report = [&](size_t index) {
+    std::lock_guard<std::mutex> lock(progressMutex);
+
+    completed++;
+
+    if (this->_progressCallback != nullptr) {
+      this->_progressCallback(results[index], completed, results.size());
+    }
+  };
+
+  const auto renderFile = [&options, &encodePool](
+                              std::shared_ptr<const Mod> mod,
+                              BatchResult &result) {
+    Generator generator(std::move(mod), options.encoding);
+
+    generator.setFrequency(options.frequency);
+    generator.setInterpolation(options.interpolation);
+
+    result.frames = generator.countFrames();
+
+    const fs::path parent = fs::path(result.output).parent_path();
+
+    if (!parent.empty()) {
+      fs::create_directories(parent);
+    }
+
+    if (options.format != OutputFormat::Flac) {
+      const AsyncWriter writer(options.format, asyncBlockSize,
+                               asyncBuffersCount);
+
+      result.bytes = writer.write(generator, result.output);
+      return;
+    }
+
+    std::ofstream stream(result.output,
+                         std::ios_base::binary | std::ios_base::trunc);
+
+    if (!stream) {
+      throw std::runtime_error(
+          fmt::format("Cannot create '{}'", result.output));
+    }
+
+    FlacWriter writer;
+
+    writer.setEncodePool(encodePool);
+    writer.write(generator, stream);
+    result.bytes = (size_t)stream.tellp();
+    stream.close();
+
+    if (!stream) {
+      throw std::runtime_error(fmt::format("Cannot write '{}'", result.output));
+    }
+  };
+
+  // Declared after everything its tasks use, so on exception its
+  // destructor finishes them before that is destroyed.
+  ThreadPool renderPool(workers);
+  std::vector<std::future<void>> rendered;
+  // Input writing each output, so no two workers truncate same file.
+  std::map<std::string, std::string> outputs;
+
+  rendered.reserve(inputs.size());
+
+  for (size_t i = 0; i < inputs.size(); i++) {
+    BatchResult &result = results[i];
+
+    result.input = inputs[i].path;
+    result.output =
+        (fs::path(outputDirectory) /
+         (inputs[i].name + BatchRenderer::getExtension(options.format)))
+            .lexically_normal()
+            .string();
+
+    const auto [output, inserted] =
+        outputs.emplace(result.output, result.input);
+
+    if (!inserted) {
+      result.error = fmt::format("Output '{}' is already written for '{}'",
+                                 result.output, output->second);
+      report(i);
+      continue;
+    }
+
+    std::error_code error;
+    const uintmax_t fileSize = fs::file_size(inputs[i].path, error);
+    size_t reserved =
+        (error ? 0 : (size_t)fileSize * loadedBytesPerFileByte) + renderBytes;
+
+    gate.acquire(reserved);
+
+    const auto loadStart = std::chrono::steady_clock::now();
+    std::shared_ptr<const Mod> mod;
+
+    try {
+      mod = registry.load(inputs[i].path);
+    } catch (const std::exception &exception) {
+      result.error = exception.what();
+    }
+
+    result.loadSeconds = secondsSince(loadStart);
+
+    if (mod == nullptr) {
+      gate.release(reserved);
+      report(i);
+      continue;
+    }
+
+    const size_t actual = mod->memoryUsage().total() + renderBytes;
+
+    gate.resize(reserved, actual);
+    reserved = actual;
+
+    rendered.push_back(renderPool.submit(
+        [&, i, reserved, mod = std::move(mod)]() mutable {
+          BatchResult &result = results[i];
+          const auto renderStart = std::chrono::steady_clock::now();
+
+          try {
+            renderFile(std::move(mod), result);
+          } catch (const std::exception &exception) {
+            result.error = exception.what();
+          }
+
+          result.renderSeconds = secondsSince(renderStart);
+
+          gate.release(reserved);
+          report(i);
+        }));
+  }
+
+  for (auto &future : rendered) {
+    future.get();
+  }
+
+  return results;
+}
+
+}  // namespace mod
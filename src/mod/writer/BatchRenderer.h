@@ -0,0 +1,112 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "OutputFormat.h"
+#include "mod/Encoding.h"
+#include "mod/Interpolation.h"
+
+namespace mod {
+
+struct BatchOptions {
+  OutputFormat format = OutputFormat::Wav;
+  Encoding encoding = Encoding::Signed16;
+  float frequency = 44100.0f;
+  Interpolation interpolation = Interpolation::Nearest;
+  // Render workers, 0 for number of hardware threads.
+  size_t workers = 0;
+  // Estimated bytes of loaded mods and render buffers in flight. One file is
+  // let through even if it alone exceeds budget.
+  size_t memoryBudget = 256 * 1024 * 1024;
+};
+
+struct BatchInput {
+  std::string path;
+  // Relative output path, extension of format is appended.
+  std::string name;
+};
+
+struct BatchResult {
+  std::string input;
+  std::string output;
+  // Empty if file was rendered.
+  std::string error;
+  size_t frames = 0;
+  size_t bytes = 0;
+  // Wall time of load and of render with write.
+  double loadSeconds = 0.0;
+  double renderSeconds = 0.0;
+
+  [[nodiscard]] bool succeeded() const { return this->error.empty(); }
+};
+
+/**
+ * Renders many mods to files in pipeline. Calling thread loads files one
+ * after another and hands them to render workers, each of which renders
+ * and writes one file at a time. Raw and WAV output is written by
+ * AsyncWriter, so disk writes overlap rendering; FLAC frames are encoded on
+ * pool shared by workers. Loading stops ahead while budget of memory in
+ * flight is used up.
+ */
+class BatchRenderer {
+ public:
+  using ProgressCallback = std::function<void(
+      const BatchResult &result, size_t completed, size_t total)>;
+
+ private:
+  BatchOptions _options;
+  ProgressCallback _progressCallback = nullptr;
+
+ public:
+  explicit BatchRenderer(BatchOptions options = {});
+
+  void setOptions(const BatchOptions &options);
+
+  [[nodiscard]] const BatchOptions &getOptions() const;
+
+  /**
+   * @param callback Called one call at a time as each file is done or
+   * fails, from worker threads, or from thread calling render for files
+   * failing to load or colliding with earlier output.
+   */
+  void setProgressCallback(ProgressCallback callback);
+
+  /**
+   * Directories are searched recursively for .mod, .xm and .s3m files and
+   * their structure is kept in names. Wildcards * and ? are expanded in last
+   * component of path. Other paths are taken as they are. Files whose
+   * names would differ only in extension keep it in name, as "song.xm".
+   * @param patterns
+   * @return Inputs in order of patterns, matches of each pattern sorted.
+   * @throws runtime_error If directory can not be read.
+   */
+  static std::vector<BatchInput> collectInputs(
+      const std::vector<std::string> &patterns);
+
+  /**
+   * @param format
+   * @return Extension with dot, as ".wav".
+   */
+  static std::string getExtension(OutputFormat format);
+
+  /**
+   * @param value "raw", "wav" or "flac".
+   * @throws invalid_argument
+   */
+  static OutputFormat formatFromString(const std::string &value);
+
+  /**
+   * Failures of single files are reported in results, batch goes on. Input
+   * whose output path was already taken by earlier input fails without
+   * being loaded.
+   * @param inputs
+   * @param outputDirectory Created if missing.
+   * @return Result of each input, in order of inputs.
+   */
+  std::vector<BatchResult> render(const std::vector<BatchInput> &inputs,
+                                  const std::string &outputDirectory) const;
+};
+
+}  // namespace mod
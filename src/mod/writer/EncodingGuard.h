@@ -0,0 +1,35 @@
+#pragma once
+
+#include "mod/Encoding.h"
+#include "mod/Generator.h"
+
+namespace mod {
+
+/**
+ * Switches generator to encoding of output while writer renders, and back to
+ * its own encoding when writing ends, also by exception.
+ */
+class EncodingGuard {
+ private:
+  Generator &_generator;
+  Encoding _originalEncoding;
+
+ public:
+  /**
+   * @param generator Must have encoding set.
+   * @param encoding
+   * @throws invalid_argument If passed unsupported encoding.
+   */
+  EncodingGuard(Generator &generator, Encoding encoding)
+      : _generator(generator),
+        _originalEncoding(generator.getAudioDataEncoding()) {
+    generator.setEncoding(encoding);
+  }
+
+  ~EncodingGuard() { this->_generator.setEncoding(this->_originalEncoding); }
+
+  EncodingGuard(const EncodingGuard &) = delete;
+  EncodingGuard &operator=(const EncodingGuard &) = delete;
+};
+
+}  // namespace mod
@@ -0,0 +1,201 @@
+#include "FlacWriter.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "EncodingGuard.h"
+#include "flac/BitWriter.h"
+#include "flac/FrameEncoder.h"
+
+namespace mod {
+
+std::array<uint8_t, FlacWriter::headerSize> FlacWriter::createHeader(
+    uint32_t frequency, size_t bitsPerSample, size_t blockSize,
+    uint64_t totalSamples) {
+  constexpr uint32_t streamInfoSize = 34;
+  constexpr uint32_t channels = 1;
+
+  flac::BitWriter writer(headerSize);
+
+  for (const char c : {'f', 'L', 'a', 'C'}) {
+    writer.write((uint8_t)c, 8);
+  }
+
+  // Last metadata block, type 0 is STREAMINFO.
+  writer.write(1, 1);
+  writer.write(0, 7);
+  writer.write(streamInfoSize, 24);
+  // Minimum and maximum block size.
+  writer.write((uint32_t)blockSize, 16);
+  writer.write((uint32_t)blockSize, 16);
+  // Minimum and maximum frame size, unknown.
+  writer.write(0, 24);
+  writer.write(0, 24);
+  writer.write(frequency, 20);
+  writer.write(channels - 1, 3);
+  writer.write((uint32_t)(bitsPerSample - 1), 5);
+  writer.write((uint32_t)(totalSamples >> 32), 4);
+  writer.write((uint32_t)totalSamples, 32);
+
+  // MD5 of audio, zero when unknown.
+  for (size_t i = 0; i < 4; i++) {
+    writer.write(0, 32);
+  }
+
+  std::array<uint8_t, headerSize> header{};
+  const std::vector<uint8_t> &data = writer.getData();
+
+  std::copy(data.begin(), data.end(), header.begin());
+
+  return header;
+}
+
+Encoding FlacWriter::toFlacEncoding(Encoding audioDataEncoding) {
+  switch (audioDataEncoding) {
+    case Encoding::Unsigned8:
+    case Encoding::Signed8:
+      return Encoding::Signed8;
+    case Encoding::Unsigned16:
+    case Encoding::Signed16:
+      return Encoding::Signed16;
+    default:
+      throw std::invalid_argument("toFlacEncoding: unknown encoding: " +
+                                  encodingToString(audioDataEncoding));
+  }
+}
+
+FlacWriter::FlacWriter(size_t blockSize, size_t lpcOrder)
+    : _blockSize(blockSize), _lpcOrder(lpcOrder) {
+  this->setBlockSize(blockSize);
+  this->setLpcOrder(lpcOrder);
+}
+
+void FlacWriter::setBlockSize(size_t blockSize) {
+  if (blockSize < 16 || blockSize > 65535) {
+    throw std::invalid_argument(
+        fmt::format("setBlockSize: {} is not in 16-65535", blockSize));
+  }
+
+  this->_blockSize = blockSize;
+}
+
+size_t FlacWriter::getBlockSize() const { return this->_blockSize; }
+
+void FlacWriter::setLpcOrder(size_t lpcOrder) {
+  if (lpcOrder > flac::FrameEncoder::maxLpcOrder) {
+    throw std::invalid_argument(
+        fmt::format("setLpcOrder: {} is above {}", lpcOrder,
+                    flac::FrameEncoder::maxLpcOrder));
+  }
+
+  this->_lpcOrder = lpcOrder;
+}
+
+size_t FlacWriter::getLpcOrder() const { return this->_lpcOrder; }
+
+void FlacWriter::setEncodePool(std::shared_ptr<ThreadPool> encodePool) {
+  this->_encodePool = std::move(encodePool);
+}
+
+void FlacWriter::write(Generator &generator, std::ostream &stream) {
+  if (!stream) {
+    throw std::runtime_error("write: stream is bad.");
+  }
+
+  const Encoding originalEncoding = generator.getAudioDataEncoding();
+  const Encoding flacEncoding = FlacWriter::toFlacEncoding(originalEncoding);
+  const size_t bytesPerFrame = bytesInEncoding(flacEncoding);
+  const size_t bitsPerSample = bytesPerFrame * 8;
+  const auto frequency = (uint32_t)generator.getFrequency();
+
+  const flac::FrameEncoder encoder(frequency, bitsPerSample, this->_lpcOrder);
+  const size_t frames = generator.countFrames();
+
+  const auto header = FlacWriter::createHeader(frequency, bitsPerSample,
+                                               this->_blockSize, frames);
+
+  stream.write((const char *)header.data(), (std::streamsize)header.size());
+
+  const std::shared_ptr<ThreadPool> pool =
+      this->_encodePool != nullptr ? this->_encodePool
+                                   : std::make_shared<ThreadPool>(0);
+
+  // Enough blocks to keep every thread busy while next batch renders.
+  const size_t batchSize =
+      std::max<size_t>(1, pool->getThreadCount()) * 4 * this->_blockSize;
+
+  const EncodingGuard encodingGuard(generator, flacEncoding);
+  generator.restart();
+
+  std::vector<uint8_t> buffer;
+  std::deque<std::future<std::vector<uint8_t>>> pending;
+  size_t rendered = 0;
+  uint64_t frameNumber = 0;
+
+  const auto renderBatch = [&]() {
+    const size_t count = std::min(batchSize, frames - rendered);
+
+    buffer.resize(count * bytesPerFrame);
+    generator.generate(buffer.data(), buffer.size());
+
+    // Shared with encoding tasks, freed with last of them.
+    auto samples = std::make_shared<std::vector<int32_t>>(count);
+
+    if (bytesPerFrame == 1) {
+      for (size_t i = 0; i < count; i++) {
+        (*samples)[i] = (int8_t)buffer[i];
+      }
+    } else {
+      for (size_t i = 0; i < count; i++) {
+        int16_t sample;
+
+        std::memcpy(&sample, buffer.data() + i * 2, sizeof(sample));
+        (*samples)[i] = sample;
+      }
+    }
+
+    for (size_t offset = 0; offset < count; offset += this->_blockSize) {
+      const size_t size = std::min(this->_blockSize, count - offset);
+
+      pending.push_back(pool->submit([encoder, samples, offset, size,
+                                      frameNumber]() {
+        return encoder.encode(samples->data() + offset, size, frameNumber);
+      }));
+
+      frameNumber++;
+    }
+
+    rendered += count;
+  };
+
+  if (rendered < frames) {
+    renderBatch();
+  }
+
+  while (!pending.empty() && stream) {
+    const size_t encoding = pending.size();
+
+    if (rendered < frames) {
+      renderBatch();
+    }
+
+    for (size_t i = 0; i < encoding && stream; i++) {
+      const std::vector<uint8_t> frame = pool->await(pending.front());
+
+      pending.pop_front();
+      stream.write((const char *)frame.data(), (std::streamsize)frame.size());
+    }
+  }
+
+  if (!stream) {
+    throw std::runtime_error("write: stream gone bad.");
+  }
+}
+
+}  // namespace mod
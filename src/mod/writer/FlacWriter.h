@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+#include "ModWriter.h"
+#include "ThreadPool.h"
+
+namespace mod {
+
+/**
+ * Writes mono FLAC at frequency of generator. Stream header is written
+ * first with length of song counted ahead, then frames in order, so stream
+ * is never seeked. Blocks of song are rendered in batches and frames of a
+ * batch are encoded on thread pool while next batch is rendered.
+ */
+class FlacWriter : public ModWriter {
+ private:
+  size_t _blockSize;
+  size_t _lpcOrder;
+  std::shared_ptr<ThreadPool> _encodePool;
+
+ public:
+  static constexpr size_t headerSize = 42;
+
+  /**
+   * @param frequency
+   * @param bitsPerSample
+   * @param blockSize Samples in every frame but last.
+   * @param totalSamples
+   * @return Stream marker and STREAMINFO block. Frame sizes and MD5 are left
+   * unknown.
+   */
+  static std::array<uint8_t, headerSize> createHeader(uint32_t frequency,
+                                                      size_t bitsPerSample,
+                                                      size_t blockSize,
+                                                      uint64_t totalSamples);
+
+  /**
+   * @param audioDataEncoding
+   * @return Signed encoding of same width, FLAC samples are signed.
+   * @throws invalid_argument
+   */
+  static Encoding toFlacEncoding(Encoding audioDataEncoding);
+
+  /**
+   * @param blockSize Samples in one frame, 16-65535.
+   * @param lpcOrder Highest LPC order tried, 0 for fixed predictors only.
+   * @throws invalid_argument If parameter is out of range.
+   */
+  explicit FlacWriter(size_t blockSize = 4096, size_t lpcOrder = 8);
+
+  ~FlacWriter() override = default;
+
+  /**
+   * @param blockSize
+   * @throws invalid_argument If not in 16-65535.
+   */
+  void setBlockSize(size_t blockSize);
+
+  [[nodiscard]] size_t getBlockSize() const;
+
+  /**
+   * @param lpcOrder
+   * @throws invalid_argument If above 32.
+   */
+  void setLpcOrder(size_t lpcOrder);
+
+  [[nodiscard]] size_t getLpcOrder() const;
+
+  /**
+   * @param encodePool Pool encoding frames. If not set, pool with thread
+   * per core is created for each write.
+   */
+  void setEncodePool(std::shared_ptr<ThreadPool> encodePool);
+
+  /**
+   * Encoding of generator is switched to signed encoding of same width while
+   * writing and restored after.
+   * @param generator
+   * @param stream
+   * @throws runtime_error If stream goes bad.
+   * @throws invalid_argument If frequency of generator can not be stored.
+   * @throws BadStateException See Generator::countFrames.
+   */
+  void write(Generator &generator, std::ostream &stream) override;
+};
+
+}  // namespace mod
@@ -0,0 +1,210 @@
+#include "MappedWriter.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "EncodingGuard.h"
+#include "WavWriter.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_WRITER_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace mod {
+
+namespace {
+
+#ifdef MAPPED_WRITER_MMAP
+
+/**
+ * Writable shared mapping of file created with given size. Blocks of file are
+ * reserved up front where posix_fallocate exists, so full disk is reported
+ * here instead of raising SIGBUS on write to mapping. Unmapped and closed on
+ * destruction, so partially written file is released on error.
+ */
+class OutputMapping {
+ private:
+  int _fd = -1;
+  uint8_t *_data = nullptr;
+  size_t _size = 0;
+
+ public:
+  OutputMapping(const std::string &path, size_t size) : _size(size) {
+    this->_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       0644);
+
+    if (this->_fd < 0) {
+      throw std::runtime_error(fmt::format("Cannot create '{}': {}", path,
+                                           std::strerror(errno)));
+    }
+
+    if (size == 0) {
+      return;
+    }
+
+#ifdef __APPLE__
+    // No posix_fallocate, file stays sparse.
+    const int error = ftruncate(this->_fd, (off_t)size) != 0 ? errno : 0;
+#else
+    // Returns error instead of setting errno.
+    const int error = posix_fallocate(this->_fd, 0, (off_t)size);
+#endif
+
+    if (error != 0) {
+      ::close(this->_fd);
+
+      throw std::runtime_error(
+          fmt::format("Cannot reserve {} bytes for '{}': {}", size, path,
+                      std::strerror(error)));
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         this->_fd, 0);
+
+    if (mapping == MAP_FAILED) {
+      const int error = errno;
+      ::close(this->_fd);
+
+      throw std::runtime_error(
+          fmt::format("Cannot map '{}': {}", path, std::strerror(error)));
+    }
+
+    this->_data = (uint8_t *)mapping;
+
+    // Output is written once front to back.
+    madvise(mapping, size, MADV_SEQUENTIAL);
+  }
+
+  ~OutputMapping() {
+    if (this->_data != nullptr) {
+      munmap(this->_data, this->_size);
+    }
+
+    ::close(this->_fd);
+  }
+
+  OutputMapping(const OutputMapping &) = delete;
+  OutputMapping &operator=(const OutputMapping &) = delete;
+
+  [[nodiscard]] uint8_t *data() const { return this->_data; }
+
+  /**
+   * Starts write back of rendered part on Linux, so dirty pages do not pile
+   * up in page cache until unmap. Does not wait for it. Elsewhere pages are
+   * written back by kernel as usual.
+   * @param offset
+   * @param size
+   */
+  void flush([[maybe_unused]] size_t offset,
+             [[maybe_unused]] size_t size) const {
+#ifdef __linux__
+    sync_file_range(this->_fd, (off_t)offset, (off_t)size,
+                    SYNC_FILE_RANGE_WRITE);
+#endif
+  }
+};
+
+#endif
+
+}  // namespace
+
+MappedWriter::MappedWriter(OutputFormat format, size_t chunkSize)
+    : _format(format), _chunkSize(chunkSize) {}
+
+void MappedWriter::setFormat(OutputFormat format) { this->_format = format; }
+
+OutputFormat MappedWriter::getFormat() const { return this->_format; }
+
+void MappedWriter::setChunkSize(size_t chunkSize) {
+  this->_chunkSize = chunkSize;
+}
+
+size_t MappedWriter::getChunkSize() const { return this->_chunkSize; }
+
+size_t MappedWriter::write(Generator &generator, const std::string &path) const {
+  if (this->_format == OutputFormat::Flac) {
+    throw std::invalid_argument("write: FLAC is not supported, use FlacWriter");
+  }
+
+  const Encoding originalEncoding = generator.getAudioDataEncoding();
+  const Encoding encoding = this->_format == OutputFormat::Wav
+                                ? WavWriter::toWavEncoding(originalEncoding)
+                                : originalEncoding;
+  const size_t bytesPerFrame = bytesInEncoding(encoding);
+  const size_t dataSize = generator.countFrames() * bytesPerFrame;
+  const size_t headerSize =
+      this->_format == OutputFormat::Wav ? WavWriter::headerSize : 0;
+
+  if (this->_format == OutputFormat::Wav &&
+      dataSize > std::numeric_limits<uint32_t>::max() - headerSize) {
+    throw std::runtime_error(
+        fmt::format("write: {} bytes of audio do not fit in WAV", dataSize));
+  }
+
+  const size_t chunkSize = std::max(
+      bytesPerFrame, this->_chunkSize / bytesPerFrame * bytesPerFrame);
+
+  const EncodingGuard encodingGuard(generator, encoding);
+  generator.restart();
+
+#ifdef MAPPED_WRITER_MMAP
+  const OutputMapping output(path, headerSize + dataSize);
+
+  if (this->_format == OutputFormat::Wav) {
+    const auto header = WavWriter::createHeader(
+        (uint32_t)generator.getFrequency(), encoding, (uint32_t)dataSize);
+
+    std::memcpy(output.data(), header.data(), header.size());
+  }
+
+  for (size_t written = 0; written < dataSize;) {
+    const size_t size = std::min(chunkSize, dataSize - written);
+
+    generator.generate(output.data() + headerSize + written, size);
+    output.flush(headerSize + written, size);
+    written += size;
+  }
+#else
+  std::ofstream stream(path, std::ios_base::binary | std::ios_base::trunc);
+
+  if (!stream) {
+    throw std::runtime_error(fmt::format("Cannot create '{}'", path));
+  }
+
+  if (this->_format == OutputFormat::Wav) {
+    const auto header = WavWriter::createHeader(
+        (uint32_t)generator.getFrequency(), encoding, (uint32_t)dataSize);
+
+    stream.write((const char *)header.data(), (std::streamsize)header.size());
+  }
+
+  std::vector<uint8_t> buffer(std::min(chunkSize, dataSize));
+
+  for (size_t written = 0; written < dataSize && stream;) {
+    const size_t size = std::min(buffer.size(), dataSize - written);
+
+    generator.generate(buffer.data(), size);
+    stream.write((const char *)buffer.data(), (std::streamsize)size);
+    written += size;
+  }
+
+  if (!stream) {
+    throw std::runtime_error(fmt::format("Cannot write '{}'", path));
+  }
+#endif
+
+  return headerSize + dataSize;
+}
+
+}  // namespace mod
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+
+#include "OutputFormat.h"
+#include "mod/Generator.h"
+
+namespace mod {
+
+/**
+ * Writes song to file pre-sized to exact output length. File is mapped into
+ * memory and generator renders straight into mapping, without copies
+ * through stream buffers and write calls. On platforms without mmap, blocks
+ * are written to file stream instead.
+ */
+class MappedWriter {
+ private:
+  OutputFormat _format;
+  size_t _chunkSize;
+
+ public:
+  /**
+   * @param format
+   * @param chunkSize Bytes rendered by single generate call.
+   */
+  explicit MappedWriter(OutputFormat format = OutputFormat::Raw,
+                        size_t chunkSize = 4 * 1024 * 1024);
+
+  void setFormat(OutputFormat format);
+
+  [[nodiscard]] OutputFormat getFormat() const;
+
+  void setChunkSize(size_t chunkSize);
+
+  [[nodiscard]] size_t getChunkSize() const;
+
+  /**
+   * Renders whole song from start. Existing file is replaced.
+   * @param generator
+   * @param path
+   * @return Bytes written.
+   * @throws invalid_argument If format is FLAC.
+   * @throws runtime_error If file cannot be created, its space cannot be
+   * reserved, for example on full disk, or it cannot be mapped, or song is
+   * too long for WAV.
+   * @throws BadStateException See Generator::countFrames.
+   */
+  size_t write(Generator &generator, const std::string &path) const;
+};
+
+}  // namespace mod
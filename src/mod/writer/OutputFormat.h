@@ -0,0 +1,18 @@
+#pragma once
+
+namespace mod {
+
+/**
+ * File format of writers rendering to file path.
+ */
+enum class OutputFormat {
+  // Headerless PCM in encoding of generator.
+  Raw = 0,
+  // Mono PCM WAV, see WavWriter::write.
+  Wav,
+  // Mono FLAC, see FlacWriter::write. Size is not known ahead, so it is not
+  // supported by writers of pre-sized output.
+  Flac,
+};
+
+}  // namespace mod
@@ -0,0 +1,162 @@
+#include "StemWriter.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "EncodingGuard.h"
+#include "WavWriter.h"
+
+namespace mod {
+
+StemWriter::StemWriter(OutputFormat format, size_t blockSize)
+    : _format(format), _blockSize(blockSize) {}
+
+void StemWriter::setFormat(OutputFormat format) { this->_format = format; }
+
+OutputFormat StemWriter::getFormat() const { return this->_format; }
+
+void StemWriter::setBlockSize(size_t blockSize) {
+  this->_blockSize = blockSize;
+}
+
+size_t StemWriter::getBlockSize() const { return this->_blockSize; }
+
+std::vector<std::string> StemWriter::createStemPaths(
+    const std::string &basePath, size_t channels, OutputFormat format) {
+  const char *extension = format == OutputFormat::Wav ? "wav" : "raw";
+  std::vector<std::string> paths;
+
+  paths.reserve(channels);
+
+  for (size_t i = 0; i < channels; i++) {
+    paths.push_back(fmt::format("{}.{:02}.{}", basePath, i + 1, extension));
+  }
+
+  return paths;
+}
+
+size_t StemWriter::write(Generator &generator,
+                         const std::vector<std::string> &stemPaths,
+                         const std::string &mixPath) const {
+  if (this->_format == OutputFormat::Flac) {
+    throw std::invalid_argument("write: FLAC stems are not supported");
+  }
+
+  const Encoding originalEncoding = generator.getAudioDataEncoding();
+  const Encoding encoding = this->_format == OutputFormat::Wav
+                                ? WavWriter::toWavEncoding(originalEncoding)
+                                : originalEncoding;
+  const size_t bytesPerFrame = bytesInEncoding(encoding);
+  const size_t dataSize = generator.countFrames() * bytesPerFrame;
+  const size_t headerSize =
+      this->_format == OutputFormat::Wav ? WavWriter::headerSize : 0;
+  const size_t channels = generator.getMod()->getChannels();
+
+  if (stemPaths.size() != channels) {
+    throw std::invalid_argument(fmt::format(
+        "write: Got {} stem paths for {} channels", stemPaths.size(),
+        channels));
+  }
+
+  if (this->_format == OutputFormat::Wav &&
+      dataSize > std::numeric_limits<uint32_t>::max() - headerSize) {
+    throw std::runtime_error(
+        fmt::format("write: {} bytes of audio do not fit in WAV", dataSize));
+  }
+
+  const size_t blockSize = std::min(
+      dataSize, std::max(bytesPerFrame,
+                         this->_blockSize / bytesPerFrame * bytesPerFrame));
+
+  // Stems first, mix at index of channels.
+  std::vector<std::string> paths(stemPaths);
+  std::vector<std::ofstream> files(channels + 1);
+  std::vector<std::vector<uint8_t>> buffers(channels + 1);
+
+  paths.push_back(mixPath);
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (paths[i].empty()) {
+      continue;
+    }
+
+    files[i].open(paths[i], std::ios_base::binary | std::ios_base::trunc);
+
+    if (!files[i]) {
+      throw std::runtime_error(fmt::format("Cannot create '{}'", paths[i]));
+    }
+
+    if (this->_format == OutputFormat::Wav) {
+      const auto header = WavWriter::createHeader(
+          (uint32_t)generator.getFrequency(), encoding, (uint32_t)dataSize);
+
+      files[i].write((const char *)header.data(),
+                     (std::streamsize)header.size());
+    }
+
+    buffers[i].resize(blockSize);
+  }
+
+  std::vector<uint8_t *> stems(channels, nullptr);
+
+  for (size_t i = 0; i < channels; i++) {
+    if (files[i].is_open()) {
+      stems[i] = buffers[i].data();
+    }
+  }
+
+  uint8_t *mix = files[channels].is_open() ? buffers[channels].data() : nullptr;
+
+  const EncodingGuard encodingGuard(generator, encoding);
+  generator.restart();
+
+  size_t failed = paths.size();
+
+  for (size_t written = 0; written < dataSize && failed == paths.size();) {
+    const size_t size = std::min(blockSize, dataSize - written);
+
+    generator.generateStems(mix, stems, size);
+
+    for (size_t i = 0; i < files.size(); i++) {
+      if (!files[i].is_open()) {
+        continue;
+      }
+
+      files[i].write((const char *)buffers[i].data(), (std::streamsize)size);
+
+      if (!files[i]) {
+        failed = i;
+        break;
+      }
+    }
+
+    written += size;
+  }
+
+  size_t opened = 0;
+
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!files[i].is_open()) {
+      continue;
+    }
+
+    files[i].close();
+    opened++;
+
+    if (!files[i] && failed == paths.size()) {
+      failed = i;
+    }
+  }
+
+  if (failed != paths.size()) {
+    throw std::runtime_error(fmt::format("Cannot write '{}'", paths[failed]));
+  }
+
+  return opened * (headerSize + dataSize);
+}
+
+}  // namespace mod
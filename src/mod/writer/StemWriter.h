@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "OutputFormat.h"
+#include "mod/Generator.h"
+
+namespace mod {
+
+/**
+ * Writes every channel of song to its own file, along with mix, in single
+ * pass of generator. Sequencing and resampling are done once for all files
+ * instead of once per soloed channel. Files are streamed block by block,
+ * all of them open at once.
+ */
+class StemWriter {
+ private:
+  OutputFormat _format;
+  size_t _blockSize;
+
+ public:
+  /**
+   * @param format
+   * @param blockSize Bytes rendered into each file at once.
+   */
+  explicit StemWriter(OutputFormat format = OutputFormat::Wav,
+                      size_t blockSize = 256 * 1024);
+
+  void setFormat(OutputFormat format);
+
+  [[nodiscard]] OutputFormat getFormat() const;
+
+  void setBlockSize(size_t blockSize);
+
+  [[nodiscard]] size_t getBlockSize() const;
+
+  /**
+   * @param basePath
+   * @param channels
+   * @param format
+   * @return Path of each channel, basePath with 1 based channel number and
+   * extension of format appended, as "song.01.wav".
+   */
+  static std::vector<std::string> createStemPaths(const std::string &basePath,
+                                                  size_t channels,
+                                                  OutputFormat format);
+
+  /**
+   * Renders whole song from start. Existing files are replaced. Encoding of
+   * generator is switched to WAV encoding for WAV and restored after.
+   * @param generator
+   * @param stemPaths Path of each channel of mod, empty to skip channel.
+   * @param mixPath Path of mix, empty to skip mix.
+   * @return Bytes written to all files.
+   * @throws invalid_argument If format is FLAC or stemPaths do not match
+   * channels of mod.
+   * @throws runtime_error If file cannot be created or written, or song is
+   * too long for WAV.
+   * @throws BadStateException See Generator::countFrames.
+   */
+  size_t write(Generator &generator, const std::vector<std::string> &stemPaths,
+               const std::string &mixPath = "") const;
+};
+
+}  // namespace mod
@@ -1,64 +1,131 @@
 #include "WavWriter.h"
 
-#include "mod/loaders/StreamUtils.h"
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "EncodingGuard.h"
 
 namespace mod {
 
-void WavWriter::writeHeader(std::ostream& stream, uint32_t dataSize) {
-  if (!stream) {
-    throw std::runtime_error("writeHeader: stream is bad.");
+std::array<uint8_t, WavWriter::headerSize> WavWriter::createHeader(
+    uint32_t frequency, Encoding audioDataEncoding, uint32_t dataSize) {
+  if (audioDataEncoding != Encoding::Unsigned8 &&
+      audioDataEncoding != Encoding::Signed16) {
+    throw std::invalid_argument(
+        fmt::format("createHeader: WAV can not store {} data",
+                    encodingToString(audioDataEncoding)));
   }
 
-  stream << "RIFF";
-  // Chunksize
-  streamutils::writeU32(stream, dataSize + 44 - 8);
-  stream << "WAVE";
-  stream << "fmt ";
-  // Subchunk 1 size
-  streamutils::writeU32(stream, (uint32_t)(16));
+  constexpr uint16_t channels = 1;
   // Audio format 1=PCM,6=mulaw,7=alaw,257=IBM
   // Mu-Law, 258=IBM A-Law, 259=ADPCM
-  streamutils::writeU16(stream, (uint16_t)(1));
-  // Number of channels
-  streamutils::writeU16(stream, (uint16_t)(1));
+  constexpr uint16_t pcmFormat = 1;
+
+  const auto bytesPerFrame =
+      (uint16_t)(bytesInEncoding(audioDataEncoding) * channels);
+
+  std::array<uint8_t, headerSize> header{};
+  size_t position = 0;
+
+  const auto put = [&header, &position](const void *value, size_t size) {
+    std::memcpy(header.data() + position, value, size);
+    position += size;
+  };
+  const auto putU16 = [&put](uint16_t value) { put(&value, sizeof(value)); };
+  const auto putU32 = [&put](uint32_t value) { put(&value, sizeof(value)); };
+
+  put("RIFF", 4);
+  // Chunksize
+  putU32(dataSize + headerSize - 8);
+  put("WAVE", 4);
+  put("fmt ", 4);
+  // Subchunk 1 size
+  putU32(16);
+  putU16(pcmFormat);
+  putU16(channels);
   // Sampling freq in Hz
-  streamutils::writeU32(stream, (uint32_t)(11025*2));
+  putU32(frequency);
   // Bytes per second
-  streamutils::writeU32(stream, (uint32_t)(11025*2 * 1));
+  putU32(frequency * bytesPerFrame);
   // 2=16-bit mono, 4=16-bit stereo
-  streamutils::writeU16(stream, (uint16_t)(1));
+  putU16(bytesPerFrame);
   // Number of bits per sample
-  streamutils::writeU16(stream, (uint16_t)(8));
-  stream << "data";
+  putU16((uint16_t)(bytesPerFrame / channels * 8));
+  put("data", 4);
   // Data chunk length
-  streamutils::writeU32(stream, dataSize);
+  putU32(dataSize);
 
-  if (!stream) {
-    throw std::runtime_error("writeHeader: stream gone bad.");
+  return header;
+}
+
+Encoding WavWriter::toWavEncoding(Encoding audioDataEncoding) {
+  switch (audioDataEncoding) {
+    case Encoding::Unsigned8:
+    case Encoding::Signed8:
+      return Encoding::Unsigned8;
+    case Encoding::Unsigned16:
+    case Encoding::Signed16:
+      return Encoding::Signed16;
+    default:
+      throw std::invalid_argument(
+          "toWavEncoding: unknown encoding: " +
+          encodingToString(audioDataEncoding));
   }
 }
 
-void WavWriter::write(Generator& generator, std::ostream& stream) {
-  WavWriter::writeHeader(stream, 0);
+WavWriter::WavWriter(size_t blockSize) : _blockSize(blockSize) {}
+
+void WavWriter::setBlockSize(size_t blockSize) {
+  this->_blockSize = blockSize;
+}
+
+size_t WavWriter::getBlockSize() const { return this->_blockSize; }
+
+void WavWriter::write(Generator &generator, std::ostream &stream) {
+  if (!stream) {
+    throw std::runtime_error("write: stream is bad.");
+  }
+
+  const Encoding originalEncoding = generator.getAudioDataEncoding();
+  const Encoding wavEncoding = WavWriter::toWavEncoding(originalEncoding);
+  const size_t bytesPerFrame = bytesInEncoding(wavEncoding);
 
-  std::streampos currentPosition = stream.tellp();
+  const size_t dataSize = generator.countFrames() * bytesPerFrame;
+
+  if (dataSize > std::numeric_limits<uint32_t>::max() - headerSize) {
+    throw std::runtime_error(
+        fmt::format("write: {} bytes of audio do not fit in WAV", dataSize));
+  }
 
+  const auto header = WavWriter::createHeader(
+      (uint32_t)generator.getFrequency(), wavEncoding, (uint32_t)dataSize);
+
+  stream.write((const char *)header.data(), (std::streamsize)header.size());
+
+  const EncodingGuard encodingGuard(generator, wavEncoding);
   generator.restart();
 
-  std::vector<uint8_t> buffer(1024);
+  const size_t blockSize =
+      std::max(bytesPerFrame, this->_blockSize / bytesPerFrame * bytesPerFrame);
 
-  while(generator.getState() != GeneratorState::Paused) {
-    generator.generate(buffer.data(), buffer.size());
+  std::vector<uint8_t> buffer(std::min(blockSize, dataSize));
 
-    stream.write((char *)buffer.data(), (std::streamsize)buffer.size());
-  }
+  for (size_t written = 0; written < dataSize && stream;) {
+    const size_t size = std::min(buffer.size(), dataSize - written);
 
-  std::streampos endPosition = stream.tellp();
+    generator.generate(buffer.data(), size);
 
-  auto dataWrote = (uint32_t)(endPosition - currentPosition);
+    stream.write((const char *)buffer.data(), (std::streamsize)size);
+    written += size;
+  }
 
-  stream.seekp(0, std::ios_base::beg);
-  this->writeHeader(stream, dataWrote);
+  if (!stream) {
+    throw std::runtime_error("write: stream gone bad.");
+  }
 }
 
-}
+}  // namespace mod
@@ -1,24 +1,63 @@
 #pragma once
 
-#include "ModWriter.h"
+#include <array>
+#include <cstdint>
 #include <iostream>
 
+#include "ModWriter.h"
+
 namespace mod {
 
+/**
+ * Writes mono PCM WAV at frequency of generator. Length of song is counted
+ * ahead, so final header is written first and stream is never seeked, which
+ * allows writing to pipes and sockets.
+ */
 class WavWriter : public ModWriter {
  private:
+  size_t _blockSize;
+
+ public:
+  static constexpr size_t headerSize = 44;
 
   /**
-   * @param stream
-   * @throw std::runtime_error
+   * @param frequency
+   * @param audioDataEncoding Unsigned8 or Signed16.
+   * @param dataSize Bytes of audio data following header.
+   * @throws invalid_argument If encoding can not be stored in WAV.
+   * @return Header of canonical PCM WAV file.
    */
-  static void writeHeader(std::ostream &stream, uint32_t dataSize);
+  static std::array<uint8_t, headerSize> createHeader(
+      uint32_t frequency, Encoding audioDataEncoding, uint32_t dataSize);
+
+  /**
+   * @param audioDataEncoding
+   * @return WAV encoding of same width, 8 bit WAV is unsigned and 16 bit
+   * signed.
+   * @throws invalid_argument
+   */
+  static Encoding toWavEncoding(Encoding audioDataEncoding);
+
+  /**
+   * @param blockSize Bytes rendered and written at once.
+   */
+  explicit WavWriter(size_t blockSize = 1024 * 1024);
 
- public:
-  WavWriter() = default;
   ~WavWriter() override = default;
 
+  void setBlockSize(size_t blockSize);
+
+  [[nodiscard]] size_t getBlockSize() const;
+
+  /**
+   * Encoding of generator is switched to WAV encoding of same width while
+   * writing and restored after.
+   * @param generator
+   * @param stream
+   * @throws runtime_error If stream goes bad or song is too long for WAV.
+   * @throws BadStateException See Generator::countFrames.
+   */
   void write(Generator &generator, std::ostream &stream) override;
 };
 
-}  // namespace mod
\ No newline at end of file
+}  // namespace mod
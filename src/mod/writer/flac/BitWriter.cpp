@@ -0,0 +1,53 @@
+#include "BitWriter.h"
+
+#include <utility>
+
+namespace mod::flac {
+
+BitWriter::BitWriter(size_t reserve) { this->_data.reserve(reserve); }
+
+void BitWriter::flush() {
+  while (this->_bits >= 8) {
+    this->_bits -= 8;
+    this->_data.push_back((uint8_t)(this->_accumulator >> this->_bits));
+  }
+}
+
+void BitWriter::writeUnary(uint32_t zeros) {
+  while (zeros >= 32) {
+    this->write(0, 32);
+    zeros -= 32;
+  }
+
+  this->write(1, zeros + 1);
+}
+
+void BitWriter::alignToByte() {
+  if (this->_bits % 8 != 0) {
+    this->write(0, 8 - this->_bits % 8);
+  }
+
+  this->flush();
+}
+
+const std::vector<uint8_t> &BitWriter::getData() {
+  this->flush();
+
+  return this->_data;
+}
+
+std::vector<uint8_t> BitWriter::release() {
+  this->flush();
+
+  std::vector<uint8_t> data = std::move(this->_data);
+
+  this->_data.clear();
+
+  return data;
+}
+
+size_t BitWriter::getBitCount() const {
+  return this->_data.size() * 8 + this->_bits;
+}
+
+}  // namespace mod::flac
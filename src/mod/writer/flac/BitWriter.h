@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mod::flac {
+
+/**
+ * Big endian, most significant bit first writer, as FLAC bitstream is
+ * written.
+ */
+class BitWriter {
+ private:
+  std::vector<uint8_t> _data;
+  uint64_t _accumulator = 0;
+  size_t _bits = 0;
+
+ public:
+  /**
+   * @param reserve Expected size in bytes.
+   */
+  explicit BitWriter(size_t reserve = 0);
+
+  /**
+   * @param value Only low bits are written.
+   * @param bits Up to 32.
+   */
+  void write(uint32_t value, size_t bits) {
+    this->_accumulator = (this->_accumulator << bits) |
+                         (value & (uint32_t)((1ull << bits) - 1));
+    this->_bits += bits;
+
+    if (this->_bits >= 32) {
+      this->flush();
+    }
+  }
+
+  /**
+   * @param value Two's complement in bits.
+   * @param bits
+   */
+  void writeSigned(int32_t value, size_t bits) {
+    this->write((uint32_t)value, bits);
+  }
+
+  /**
+   * Zeros followed by one.
+   * @param zeros
+   */
+  void writeUnary(uint32_t zeros);
+
+  /**
+   * Zigzag mapped value, quotient in unary, then parameter low bits.
+   * @param value
+   * @param parameter
+   */
+  void writeRice(int32_t value, size_t parameter) {
+    const auto folded =
+        (uint32_t)(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+
+    this->writeUnary(folded >> parameter);
+
+    if (parameter != 0) {
+      this->write(folded, parameter);
+    }
+  }
+
+  /**
+   * Pads with zero bits to byte boundary.
+   */
+  void alignToByte();
+
+  /**
+   * @return Bytes written, bits of incomplete byte excluded.
+   */
+  [[nodiscard]] const std::vector<uint8_t> &getData();
+
+  /**
+   * @return Data, writer is left empty.
+   */
+  [[nodiscard]] std::vector<uint8_t> release();
+
+  [[nodiscard]] size_t getBitCount() const;
+
+ private:
+  /**
+   * Moves whole bytes of accumulator to data.
+   */
+  void flush();
+};
+
+}  // namespace mod::flac
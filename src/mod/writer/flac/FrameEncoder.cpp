@@ -0,0 +1,735 @@
+#include "FrameEncoder.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+
+namespace mod::flac {
+
+namespace {
+
+constexpr uint32_t subframeConstant = 0b000000;
+constexpr uint32_t subframeVerbatim = 0b000001;
+constexpr uint32_t subframeFixed = 0b001000;
+constexpr uint32_t subframeLpc = 0b100000;
+
+constexpr uint32_t residualRice = 0;
+constexpr uint32_t residualRice2 = 1;
+constexpr size_t maxRiceParameter = 14;
+// 31 is escape code of RICE2.
+constexpr size_t maxRice2Parameter = 30;
+
+constexpr int maxLpcShift = 15;
+
+// Prediction of fixed polynomial predictors, from newest sample back.
+constexpr int32_t fixedCoefficients[FrameEncoder::maxFixedOrder + 1]
+                                   [FrameEncoder::maxFixedOrder] = {
+                                       {0, 0, 0, 0},
+                                       {1, 0, 0, 0},
+                                       {2, -1, 0, 0},
+                                       {3, -3, 1, 0},
+                                       {4, -6, 4, -1},
+                                   };
+
+constexpr std::array<uint8_t, 256> createCrc8Table() {
+  std::array<uint8_t, 256> table{};
+
+  for (size_t i = 0; i < table.size(); i++) {
+    auto crc = (uint8_t)i;
+
+    for (size_t bit = 0; bit < 8; bit++) {
+      crc = (uint8_t)((crc & 0x80) != 0 ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+
+    table[i] = crc;
+  }
+
+  return table;
+}
+
+constexpr std::array<uint16_t, 256> createCrc16Table() {
+  std::array<uint16_t, 256> table{};
+
+  for (size_t i = 0; i < table.size(); i++) {
+    auto crc = (uint16_t)(i << 8);
+
+    for (size_t bit = 0; bit < 8; bit++) {
+      crc = (uint16_t)((crc & 0x8000) != 0 ? (crc << 1) ^ 0x8005 : crc << 1);
+    }
+
+    table[i] = crc;
+  }
+
+  return table;
+}
+
+constexpr std::array<uint8_t, 256> crc8Table = createCrc8Table();
+constexpr std::array<uint16_t, 256> crc16Table = createCrc16Table();
+
+uint8_t crc8(const std::vector<uint8_t> &data) {
+  uint8_t crc = 0;
+
+  for (const uint8_t byte : data) {
+    crc = crc8Table[crc ^ byte];
+  }
+
+  return crc;
+}
+
+uint16_t crc16(const std::vector<uint8_t> &data) {
+  uint16_t crc = 0;
+
+  for (const uint8_t byte : data) {
+    crc = (uint16_t)((crc << 8) ^ crc16Table[(crc >> 8) ^ byte]);
+  }
+
+  return crc;
+}
+
+uint32_t foldResidual(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * @param sum Of folded residuals in partition.
+ * @param count Of residuals in partition.
+ * @param parameter Receives best parameter.
+ * @return Estimated bits of residuals, parameter excluded.
+ */
+uint64_t planPartition(uint64_t sum, size_t count, size_t &parameter) {
+  if (count == 0 || sum < count) {
+    parameter = 0;
+    return count + sum;
+  }
+
+  // Around log2 of mean, so quotients are small but not all zero.
+  size_t guess = 0;
+
+  while (guess < maxRice2Parameter && (sum >> (guess + 1)) >= count) {
+    guess++;
+  }
+
+  uint64_t bestBits = std::numeric_limits<uint64_t>::max();
+  const size_t last = std::min(guess + 1, maxRice2Parameter);
+
+  for (size_t k = guess > 0 ? guess - 1 : 0; k <= last; k++) {
+    const uint64_t bits = (uint64_t)count * (k + 1) + (sum >> k);
+
+    if (bits < bestBits) {
+      bestBits = bits;
+      parameter = k;
+    }
+  }
+
+  return bestBits;
+}
+
+size_t sampleSizeCode(size_t bitsPerSample) {
+  switch (bitsPerSample) {
+    case 8:
+      return 0b001;
+    case 12:
+      return 0b010;
+    case 16:
+      return 0b100;
+    case 20:
+      return 0b101;
+    case 24:
+      return 0b110;
+    default:
+      throw std::invalid_argument(fmt::format(
+          "FrameEncoder: unsupported bits per sample: {}", bitsPerSample));
+  }
+}
+
+}  // namespace
+
+FrameEncoder::FrameEncoder(uint32_t sampleRate, size_t bitsPerSample,
+                           size_t lpcOrder, size_t lpcPrecision,
+                           size_t partitionOrder)
+    : _sampleRate(sampleRate),
+      _bitsPerSample(bitsPerSample),
+      _lpcOrder(lpcOrder),
+      _lpcPrecision(lpcPrecision),
+      _partitionOrder(partitionOrder) {
+  sampleSizeCode(bitsPerSample);
+
+  if (sampleRate == 0 || sampleRate > 655350) {
+    throw std::invalid_argument(
+        fmt::format("FrameEncoder: unsupported sample rate: {}", sampleRate));
+  }
+
+  if (lpcOrder > maxLpcOrder) {
+    throw std::invalid_argument(fmt::format(
+        "FrameEncoder: LPC order {} is above {}", lpcOrder, maxLpcOrder));
+  }
+
+  if (lpcPrecision < 5 || lpcPrecision > 15) {
+    throw std::invalid_argument(fmt::format(
+        "FrameEncoder: LPC precision {} is not in 5-15", lpcPrecision));
+  }
+
+  if (partitionOrder > maxPartitionOrder) {
+    throw std::invalid_argument(
+        fmt::format("FrameEncoder: partition order {} is above {}",
+                    partitionOrder, maxPartitionOrder));
+  }
+}
+
+FrameEncoder::ResidualCoding FrameEncoder::planResidual(
+    const int32_t *residual, size_t blockSize, size_t predictorOrder,
+    size_t maxPartitionOrder) {
+  // Partitions must split block evenly and first one must not be shorter
+  // than warm up.
+  size_t finestOrder = 0;
+
+  while (finestOrder < maxPartitionOrder &&
+         blockSize % ((size_t)2 << finestOrder) == 0 &&
+         (blockSize >> (finestOrder + 1)) > predictorOrder) {
+    finestOrder++;
+  }
+
+  std::vector<uint64_t> sums((size_t)1 << finestOrder, 0);
+  const size_t finestSize = blockSize >> finestOrder;
+
+  for (size_t i = predictorOrder; i < blockSize; i++) {
+    sums[i / finestSize] += foldResidual(residual[i]);
+  }
+
+  ResidualCoding best;
+  best.bits = std::numeric_limits<size_t>::max();
+
+  for (size_t order = finestOrder + 1; order-- > 0;) {
+    const size_t partitions = (size_t)1 << order;
+    const size_t partitionSize = blockSize >> order;
+
+    if (order != finestOrder) {
+      // Merges pairs of finer partitions in place.
+      for (size_t i = 0; i < partitions; i++) {
+        sums[i] = sums[2 * i] + sums[2 * i + 1];
+      }
+    }
+
+    ResidualCoding coding;
+    coding.partitionOrder = order;
+    coding.parameters.resize(partitions);
+
+    size_t bits = 0;
+    size_t highest = 0;
+
+    for (size_t i = 0; i < partitions; i++) {
+      const size_t count =
+          i == 0 ? partitionSize - predictorOrder : partitionSize;
+      size_t parameter = 0;
+
+      bits += (size_t)planPartition(sums[i], count, parameter);
+      coding.parameters[i] = (uint8_t)parameter;
+      highest = std::max(highest, parameter);
+    }
+
+    const size_t parameterBits = highest > maxRiceParameter ? 5 : 4;
+
+    coding.bits = 2 + 4 + partitions * parameterBits + bits;
+
+    if (coding.bits < best.bits) {
+      best = std::move(coding);
+    }
+  }
+
+  return best;
+}
+
+void FrameEncoder::writeResidual(BitWriter &writer, const int32_t *residual,
+                                 size_t blockSize, size_t predictorOrder,
+                                 const ResidualCoding &coding) {
+  const bool rice2 =
+      *std::max_element(coding.parameters.begin(), coding.parameters.end()) >
+      maxRiceParameter;
+  const size_t parameterBits = rice2 ? 5 : 4;
+  const size_t partitionSize = blockSize >> coding.partitionOrder;
+
+  writer.write(rice2 ? residualRice2 : residualRice, 2);
+  writer.write((uint32_t)coding.partitionOrder, 4);
+
+  for (size_t i = 0; i < coding.parameters.size(); i++) {
+    const size_t parameter = coding.parameters[i];
+    const size_t end = (i + 1) * partitionSize;
+
+    writer.write((uint32_t)parameter, parameterBits);
+
+    for (size_t j = i == 0 ? predictorOrder : i * partitionSize; j < end;
+         j++) {
+      writer.writeRice(residual[j], parameter);
+    }
+  }
+}
+
+void FrameEncoder::computeFixedResidual(const int32_t *samples,
+                                        size_t blockSize, size_t order,
+                                        int32_t *residual) {
+  const int32_t *coefficients = fixedCoefficients[order];
+
+  for (size_t i = 0; i < order; i++) {
+    residual[i] = samples[i];
+  }
+
+  for (size_t i = order; i < blockSize; i++) {
+    int32_t prediction = 0;
+
+    for (size_t j = 0; j < order; j++) {
+      prediction += coefficients[j] * samples[i - 1 - j];
+    }
+
+    residual[i] = samples[i] - prediction;
+  }
+}
+
+bool FrameEncoder::computeLpcResidual(const int32_t *samples,
+                                      size_t blockSize,
+                                      const std::vector<int32_t> &coefficients,
+                                      size_t shift, int32_t *residual) {
+  const size_t order = coefficients.size();
+
+  for (size_t i = 0; i < order; i++) {
+    residual[i] = samples[i];
+  }
+
+  for (size_t i = order; i < blockSize; i++) {
+    int64_t sum = 0;
+
+    for (size_t j = 0; j < order; j++) {
+      sum += (int64_t)coefficients[j] * samples[i - 1 - j];
+    }
+
+    const int64_t value = samples[i] - (sum >> shift);
+
+    if (value < std::numeric_limits<int32_t>::min() ||
+        value > std::numeric_limits<int32_t>::max()) {
+      return false;
+    }
+
+    residual[i] = (int32_t)value;
+  }
+
+  return true;
+}
+
+std::vector<std::vector<double>> FrameEncoder::computeLpc(
+    const int32_t *samples, size_t blockSize, size_t maxOrder,
+    std::vector<double> &errors) {
+  std::vector<double> windowed(blockSize);
+  const double half = ((double)blockSize - 1.0) / 2.0;
+
+  for (size_t i = 0; i < blockSize; i++) {
+    const double position = half > 0.0 ? ((double)i - half) / half : 0.0;
+
+    windowed[i] = samples[i] * (1.0 - position * position);
+  }
+
+  std::vector<double> autocorrelation(maxOrder + 1, 0.0);
+
+  for (size_t lag = 0; lag <= maxOrder; lag++) {
+    double sum = 0.0;
+
+    for (size_t i = lag; i < blockSize; i++) {
+      sum += windowed[i] * windowed[i - lag];
+    }
+
+    autocorrelation[lag] = sum;
+  }
+
+  std::vector<std::vector<double>> result;
+  errors.clear();
+
+  if (autocorrelation[0] <= 0.0) {
+    return result;
+  }
+
+  std::vector<double> lpc(maxOrder, 0.0);
+  double error = autocorrelation[0];
+
+  for (size_t i = 0; i < maxOrder; i++) {
+    double reflection = -autocorrelation[i + 1];
+
+    for (size_t j = 0; j < i; j++) {
+      reflection -= lpc[j] * autocorrelation[i - j];
+    }
+
+    reflection /= error;
+
+    lpc[i] = reflection;
+
+    for (size_t j = 0; j < i / 2; j++) {
+      const double previous = lpc[j];
+
+      lpc[j] += reflection * lpc[i - 1 - j];
+      lpc[i - 1 - j] += reflection * previous;
+    }
+
+    if (i % 2 != 0) {
+      lpc[i / 2] += lpc[i / 2] * reflection;
+    }
+
+    error *= 1.0 - reflection * reflection;
+
+    std::vector<double> &coefficients = result.emplace_back(i + 1);
+
+    for (size_t j = 0; j <= i; j++) {
+      coefficients[j] = -lpc[j];
+    }
+
+    errors.push_back(error);
+
+    // Higher orders can not improve exact prediction.
+    if (error <= 0.0) {
+      break;
+    }
+  }
+
+  return result;
+}
+
+bool FrameEncoder::quantizeLpc(const std::vector<double> &coefficients,
+                               size_t precision,
+                               std::vector<int32_t> &quantized,
+                               size_t &shift) {
+  double highest = 0.0;
+
+  for (const double coefficient : coefficients) {
+    highest = std::max(highest, std::fabs(coefficient));
+  }
+
+  if (highest <= 0.0 || !std::isfinite(highest)) {
+    return false;
+  }
+
+  int exponent = 0;
+  std::frexp(highest, &exponent);
+
+  const int bestShift =
+      std::min(maxLpcShift, (int)precision - 1 - exponent);
+
+  // Negative shifts are reserved by format.
+  if (bestShift < 0) {
+    return false;
+  }
+
+  const auto limit = (int32_t)((1u << (precision - 1)) - 1);
+  double carried = 0.0;
+
+  quantized.resize(coefficients.size());
+
+  for (size_t i = 0; i < coefficients.size(); i++) {
+    // Rounding error is carried to next coefficient, so it does not add up.
+    const double value = std::ldexp(coefficients[i], bestShift) + carried;
+    const auto rounded =
+        std::clamp((int32_t)std::lround(value), -limit - 1, limit);
+
+    carried = value - rounded;
+    quantized[i] = rounded;
+  }
+
+  shift = (size_t)bestShift;
+
+  return true;
+}
+
+void FrameEncoder::writeHeader(BitWriter &writer, size_t blockSize,
+                               uint64_t frameNumber) const {
+  uint32_t blockSizeCode;
+
+  switch (blockSize) {
+    case 192:
+      blockSizeCode = 1;
+      break;
+    case 576:
+    case 1152:
+    case 2304:
+    case 4608:
+      blockSizeCode = 2 + (uint32_t)std::log2(blockSize / 576);
+      break;
+    case 256:
+    case 512:
+    case 1024:
+    case 2048:
+    case 4096:
+    case 8192:
+    case 16384:
+    case 32768:
+      blockSizeCode = 8 + (uint32_t)std::log2(blockSize / 256);
+      break;
+    default:
+      blockSizeCode = blockSize <= 256 ? 6 : 7;
+      break;
+  }
+
+  uint32_t sampleRateCode;
+
+  switch (this->_sampleRate) {
+    case 88200:
+      sampleRateCode = 1;
+      break;
+    case 176400:
+      sampleRateCode = 2;
+      break;
+    case 192000:
+      sampleRateCode = 3;
+      break;
+    case 8000:
+      sampleRateCode = 4;
+      break;
+    case 16000:
+      sampleRateCode = 5;
+      break;
+    case 22050:
+      sampleRateCode = 6;
+      break;
+    case 24000:
+      sampleRateCode = 7;
+      break;
+    case 32000:
+      sampleRateCode = 8;
+      break;
+    case 44100:
+      sampleRateCode = 9;
+      break;
+    case 48000:
+      sampleRateCode = 10;
+      break;
+    case 96000:
+      sampleRateCode = 11;
+      break;
+    default:
+      if (this->_sampleRate % 1000 == 0 && this->_sampleRate <= 255000) {
+        sampleRateCode = 12;
+      } else if (this->_sampleRate <= 65535) {
+        sampleRateCode = 13;
+      } else if (this->_sampleRate % 10 == 0 &&
+                 this->_sampleRate <= 655350) {
+        sampleRateCode = 14;
+      } else {
+        // Not representable in frame header, taken from STREAMINFO.
+        sampleRateCode = 0;
+      }
+      break;
+  }
+
+  // Sync code, fixed block size stream.
+  writer.write(0xFFF8, 16);
+  writer.write(blockSizeCode, 4);
+  writer.write(sampleRateCode, 4);
+  // Mono.
+  writer.write(0, 4);
+  writer.write((uint32_t)sampleSizeCode(this->_bitsPerSample), 3);
+  writer.write(0, 1);
+
+  // Frame number in UTF-8 like coding, up to 7 bytes.
+  if (frameNumber < 0x80) {
+    writer.write((uint32_t)frameNumber, 8);
+  } else {
+    size_t bytes = 2;
+
+    while (bytes < 7 && frameNumber >= (uint64_t)1 << (5 * bytes + 1)) {
+      bytes++;
+    }
+
+    const auto prefix = (uint32_t)(0xFF00 >> bytes) & 0xFF;
+
+    writer.write(prefix | (uint32_t)(frameNumber >> (6 * (bytes - 1))), 8);
+
+    for (size_t i = bytes - 1; i-- > 0;) {
+      writer.write(0x80 | (uint32_t)((frameNumber >> (6 * i)) & 0x3F), 8);
+    }
+  }
+
+  if (blockSizeCode == 6) {
+    writer.write((uint32_t)(blockSize - 1), 8);
+  } else if (blockSizeCode == 7) {
+    writer.write((uint32_t)(blockSize - 1), 16);
+  }
+
+  if (sampleRateCode == 12) {
+    writer.write(this->_sampleRate / 1000, 8);
+  } else if (sampleRateCode == 13) {
+    writer.write(this->_sampleRate, 16);
+  } else if (sampleRateCode == 14) {
+    writer.write(this->_sampleRate / 10, 16);
+  }
+
+  writer.write(crc8(writer.getData()), 8);
+}
+
+void FrameEncoder::writeSubframe(BitWriter &writer, const int32_t *samples,
+                                 size_t blockSize) const {
+  const size_t bps = this->_bitsPerSample;
+
+  if (std::all_of(samples, samples + blockSize,
+                  [samples](int32_t sample) { return sample == samples[0]; })) {
+    writer.write(subframeConstant << 1, 8);
+    writer.writeSigned(samples[0], bps);
+    return;
+  }
+
+  size_t bestBits = blockSize * bps;
+  uint32_t bestType = subframeVerbatim;
+  size_t bestOrder = 0;
+
+  // Fixed predictor with least absolute residual, as cheap estimate of
+  // its coded size. Residual of each order is difference of residuals of
+  // previous order, values before block are taken as zero.
+  const size_t maxFixed = std::min(maxFixedOrder, blockSize - 1);
+  std::array<uint64_t, maxFixedOrder + 1> fixedSums{};
+  std::array<int64_t, maxFixedOrder + 1> previous{};
+
+  for (size_t i = 0; i < blockSize; i++) {
+    std::array<int64_t, maxFixedOrder + 1> current{};
+
+    current[0] = samples[i];
+
+    for (size_t order = 1; order <= maxFixedOrder; order++) {
+      current[order] = current[order - 1] - previous[order - 1];
+    }
+
+    if (i >= maxFixed) {
+      for (size_t order = 0; order <= maxFixedOrder; order++) {
+        fixedSums[order] += (uint64_t)std::llabs(current[order]);
+      }
+    }
+
+    previous = current;
+  }
+
+  const size_t fixedOrder =
+      std::min_element(fixedSums.begin(), fixedSums.begin() + maxFixed + 1) -
+      fixedSums.begin();
+
+  std::vector<int32_t> fixedResidual(blockSize);
+  computeFixedResidual(samples, blockSize, fixedOrder, fixedResidual.data());
+
+  const ResidualCoding fixedCoding = planResidual(
+      fixedResidual.data(), blockSize, fixedOrder, this->_partitionOrder);
+
+  if (fixedOrder * bps + fixedCoding.bits < bestBits) {
+    bestBits = fixedOrder * bps + fixedCoding.bits;
+    bestType = subframeFixed;
+    bestOrder = fixedOrder;
+  }
+
+  std::vector<int32_t> lpcResidual;
+  std::vector<int32_t> quantized;
+  size_t shift = 0;
+  ResidualCoding lpcCoding;
+
+  const size_t lpcOrder = std::min(this->_lpcOrder, blockSize - 1);
+
+  if (lpcOrder > 0) {
+    std::vector<double> errors;
+    const auto coefficients =
+        computeLpc(samples, blockSize, lpcOrder, errors);
+
+    // Order with least estimated size, residual bits from prediction error.
+    size_t order = 0;
+    double orderBits = std::numeric_limits<double>::max();
+
+    for (size_t i = 0; i < coefficients.size(); i++) {
+      const double error = errors[i] * 0.5 / (double)blockSize;
+      const double residualBits =
+          error > 1.0 ? 0.5 * std::log2(error) : 0.0;
+      const double bits =
+          residualBits * (double)(blockSize - i - 1) +
+          (double)(i + 1) * (double)(bps + this->_lpcPrecision);
+
+      if (bits < orderBits) {
+        orderBits = bits;
+        order = i + 1;
+      }
+    }
+
+    if (order > 0 &&
+        quantizeLpc(coefficients[order - 1], this->_lpcPrecision, quantized,
+                    shift)) {
+      lpcResidual.resize(blockSize);
+
+      if (computeLpcResidual(samples, blockSize, quantized, shift,
+                             lpcResidual.data())) {
+        lpcCoding = planResidual(lpcResidual.data(), blockSize, order,
+                                 this->_partitionOrder);
+
+        const size_t bits =
+            order * (bps + this->_lpcPrecision) + 4 + 5 + lpcCoding.bits;
+
+        if (bits < bestBits) {
+          bestBits = bits;
+          bestType = subframeLpc;
+          bestOrder = order;
+        }
+      }
+    }
+  }
+
+  switch (bestType) {
+    case subframeFixed:
+      writer.write((subframeFixed | (uint32_t)bestOrder) << 1, 8);
+
+      for (size_t i = 0; i < bestOrder; i++) {
+        writer.writeSigned(samples[i], bps);
+      }
+
+      writeResidual(writer, fixedResidual.data(), blockSize, bestOrder,
+                    fixedCoding);
+      break;
+    case subframeLpc:
+      writer.write((subframeLpc | (uint32_t)(bestOrder - 1)) << 1, 8);
+
+      for (size_t i = 0; i < bestOrder; i++) {
+        writer.writeSigned(samples[i], bps);
+      }
+
+      writer.write((uint32_t)(this->_lpcPrecision - 1), 4);
+      writer.write((uint32_t)shift, 5);
+
+      for (const int32_t coefficient : quantized) {
+        writer.writeSigned(coefficient, this->_lpcPrecision);
+      }
+
+      writeResidual(writer, lpcResidual.data(), blockSize, bestOrder,
+                    lpcCoding);
+      break;
+    default:
+      writer.write(subframeVerbatim << 1, 8);
+
+      for (size_t i = 0; i < blockSize; i++) {
+        writer.writeSigned(samples[i], bps);
+      }
+      break;
+  }
+}
+
+std::vector<uint8_t> FrameEncoder::encode(const int32_t *samples,
+                                          size_t blockSize,
+                                          uint64_t frameNumber) const {
+  if (blockSize == 0 || blockSize > 65536) {
+    throw std::invalid_argument(
+        fmt::format("encode: block size {} is not in 1-65536", blockSize));
+  }
+
+  BitWriter writer(blockSize * this->_bitsPerSample / 8 + 32);
+
+  this->writeHeader(writer, blockSize, frameNumber);
+  this->writeSubframe(writer, samples, blockSize);
+  writer.alignToByte();
+  writer.write(crc16(writer.getData()), 16);
+
+  return writer.release();
+}
+
+uint32_t FrameEncoder::getSampleRate() const { return this->_sampleRate; }
+
+size_t FrameEncoder::getBitsPerSample() const { return this->_bitsPerSample; }
+
+}  // namespace mod::flac
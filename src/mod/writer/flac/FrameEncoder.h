@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BitWriter.h"
+
+namespace mod::flac {
+
+/**
+ * Encodes one block of mono samples into complete FLAC frame. Frames are
+ * independent of each other, so different blocks can be encoded
+ * concurrently with one shared encoder.
+ *
+ * Each subframe is stored as cheapest of constant, verbatim, fixed
+ * polynomial predictor of order 0-4 and LPC predictor with coefficients
+ * from windowed autocorrelation. Residual is coded with partitioned Rice
+ * code.
+ */
+class FrameEncoder {
+ public:
+  static constexpr size_t maxFixedOrder = 4;
+  static constexpr size_t maxLpcOrder = 32;
+  static constexpr size_t maxPartitionOrder = 15;
+
+ private:
+  struct ResidualCoding {
+    size_t partitionOrder = 0;
+    std::vector<uint8_t> parameters;
+    // Including coding method and parameters.
+    size_t bits = 0;
+  };
+
+  uint32_t _sampleRate;
+  size_t _bitsPerSample;
+  size_t _lpcOrder;
+  size_t _lpcPrecision;
+  size_t _partitionOrder;
+
+#pragma region private static
+  /**
+   * Picks partition order and Rice parameters with least estimated size.
+   * @param residual Of block, first predictorOrder values are not coded.
+   * @param blockSize
+   * @param predictorOrder
+   * @param maxPartitionOrder
+   */
+  static ResidualCoding planResidual(const int32_t *residual, size_t blockSize,
+                                     size_t predictorOrder,
+                                     size_t maxPartitionOrder);
+
+  static void writeResidual(BitWriter &writer, const int32_t *residual,
+                            size_t blockSize, size_t predictorOrder,
+                            const ResidualCoding &coding);
+
+  /**
+   * @param samples
+   * @param blockSize
+   * @param order
+   * @param residual Receives blockSize values, warm up included.
+   */
+  static void computeFixedResidual(const int32_t *samples, size_t blockSize,
+                                   size_t order, int32_t *residual);
+
+  /**
+   * @return false if some residual does not fit in 32 bits.
+   */
+  static bool computeLpcResidual(const int32_t *samples, size_t blockSize,
+                                 const std::vector<int32_t> &coefficients,
+                                 size_t shift, int32_t *residual);
+
+  /**
+   * Levinson-Durbin recursion on Welch windowed autocorrelation.
+   * @param samples
+   * @param blockSize
+   * @param maxOrder
+   * @param errors Receives prediction error of each order, index 0 is order 1.
+   * @return Coefficients of each order, index 0 is order 1.
+   */
+  static std::vector<std::vector<double>> computeLpc(
+      const int32_t *samples, size_t blockSize, size_t maxOrder,
+      std::vector<double> &errors);
+
+  /**
+   * @param coefficients
+   * @param precision Bits of each quantized coefficient.
+   * @param quantized
+   * @param shift
+   * @return false if coefficients can not be represented with allowed shift.
+   */
+  static bool quantizeLpc(const std::vector<double> &coefficients,
+                          size_t precision, std::vector<int32_t> &quantized,
+                          size_t &shift);
+#pragma endregion
+
+#pragma region private
+  void writeHeader(BitWriter &writer, size_t blockSize,
+                   uint64_t frameNumber) const;
+
+  void writeSubframe(BitWriter &writer, const int32_t *samples,
+                     size_t blockSize) const;
+#pragma endregion
+
+ public:
+  /**
+   * @param sampleRate Up to 655350 Hz.
+   * @param bitsPerSample 8 or 16.
+   * @param lpcOrder Highest LPC order tried, 0 disables LPC.
+   * @param lpcPrecision Bits of quantized LPC coefficient, 5-15.
+   * @param partitionOrder Highest Rice partition order tried.
+   * @throws invalid_argument If some parameter is out of range.
+   */
+  FrameEncoder(uint32_t sampleRate, size_t bitsPerSample, size_t lpcOrder = 8,
+               size_t lpcPrecision = 12, size_t partitionOrder = 6);
+
+  /**
+   * @param samples Signed samples in bitsPerSample.
+   * @param blockSize 1-65536 samples.
+   * @param frameNumber Index of frame in stream, all frames but last must
+   * have same size.
+   * @return Frame with header and CRCs.
+   * @throws invalid_argument If blockSize is out of range.
+   */
+  [[nodiscard]] std::vector<uint8_t> encode(const int32_t *samples,
+                                            size_t blockSize,
+                                            uint64_t frameNumber) const;
+
+  [[nodiscard]] uint32_t getSampleRate() const;
+
+  [[nodiscard]] size_t getBitsPerSample() const;
+};
+
+}  // namespace mod::flac
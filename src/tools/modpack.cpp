@@ -0,0 +1,59 @@
+#include <fmt/format.h>
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "mod/loaders/ModLoader.h"
+#include "mod/pack/PackWriter.h"
+
+/**
+ * Builds library pack from mod files: modpack <output> <mod>...
+ * Entries are named by paths as given. Files which fail to load are
+ * reported and skipped.
+ */
+int main(int argc, char **argv) {
+  using namespace mod;
+
+  if (argc < 3) {
+    std::cerr << "Usage: modpack <output> <mod>..." << std::endl;
+    return 1;
+  }
+
+  std::ofstream stream(argv[1], std::ios::binary | std::ios::trunc);
+
+  if (!stream) {
+    std::cerr << fmt::format("Cannot open '{}' for writing", argv[1])
+              << std::endl;
+    return 1;
+  }
+
+  try {
+    PackWriter writer(stream);
+    ModLoader loader;
+    size_t failed = 0;
+
+    for (int i = 2; i < argc; i++) {
+      const std::string path = argv[i];
+
+      try {
+        writer.add(path, *loader.load(path));
+      } catch (const std::exception &exception) {
+        std::cerr << fmt::format("Skipping '{}': {}", path, exception.what())
+                  << std::endl;
+        failed++;
+      }
+    }
+
+    writer.finish();
+
+    std::cout << fmt::format("Packed {} mods, skipped {}",
+                             writer.getEntryCount(), failed)
+              << std::endl;
+  } catch (const std::exception &exception) {
+    std::cerr << exception.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}